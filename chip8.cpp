@@ -0,0 +1,725 @@
+#include <algorithm>
+#include <bit>
+#include <fstream>
+#include <vector>
+
+#include "main.h"
+#include "debugger.h"
+#include "rom_library.h"
+#include "tracer.h"
+
+
+namespace
+{
+    //Shared by every cleared display
+    auto get_blank_display() -> const std::shared_ptr<Chip8::Display_Buffer>&
+    {
+        static const auto blank_display = std::make_shared<Chip8::Display_Buffer>();
+        return blank_display;
+    }
+
+    //Pixel indices are row major like the unpacked display was
+    auto get_pixel_mask(const std::size_t index) -> std::uint64_t
+    {
+        return std::uint64_t{1} << (Chip8::DISPLAY_WIDTH - 1 - index % Chip8::DISPLAY_WIDTH);
+    }
+
+    auto get_pixel(const Chip8::Display& display, const std::size_t index) -> std::uint8_t
+    {
+        return (display[index / Chip8::DISPLAY_WIDTH] & get_pixel_mask(index)) != 0;
+    }
+
+    //Same messages as the memory and stack checks had before the core took them over
+    [[noreturn, gnu::cold]] auto throw_core_status(const Core_Status status) -> void
+    {
+        switch (status)
+        {
+        case Core_Status::INVALID_INSTRUCTION: throw std::invalid_argument("Instruction is not valid!");
+        case Core_Status::STACK_OVERFLOW: throw std::out_of_range("Stack overflow!");
+        case Core_Status::STACK_UNDERFLOW: throw std::out_of_range("Stack underflow!");
+        default: throw std::out_of_range("Memory address out of range!");
+        }
+    }
+}
+
+
+//The machine core_execute runs on: copy-on-write memory and display, with the hashes and the debugger kept up to date
+class Chip8::Core_Access
+{
+public:
+    explicit Core_Access(Chip8& chip8): m_chip8{chip8}
+    {
+    }
+
+    auto cpu() -> Cpu_State& { return m_chip8.m_cpu; }
+    auto random() -> Pcg32& { return m_chip8.m_random; }
+    auto load(const int address) const -> std::uint8_t { return m_chip8.m_memory.at(address); }
+    auto store(const int address, const std::uint8_t value) -> void { m_chip8.store_memory(address, value); }
+    auto display() -> Display& { return m_chip8.get_writable_display(); }
+
+    auto clear_display() -> void
+    {
+        if (is_exclusively_owned(m_chip8.m_display))
+        {
+            m_chip8.m_display->rows.fill(0);
+        }
+        else
+        {
+            m_chip8.m_display = get_blank_display();
+        }
+        m_chip8.m_display_hash = 0;
+    }
+
+    auto pixel_flipped(const int index) -> void
+    {
+        m_chip8.m_display_hash ^= zobrist_pixel_key(index);
+    }
+
+    auto stack_changed(const int depth, const std::uint16_t address) -> void
+    {
+        m_chip8.m_stack_hash ^= zobrist_stack_key(depth, address);
+    }
+
+private:
+    Chip8& m_chip8;
+};
+
+
+Chip8::Chip8()
+{
+    reset();
+}
+
+Chip8::Chip8(const Chip8& other)
+{
+    copy_state_from(other);
+}
+
+auto Chip8::fork() const -> std::unique_ptr<Chip8>
+{
+    return std::unique_ptr<Chip8>(new Chip8(*this));
+}
+
+auto Chip8::copy_state_from(const Chip8& other) -> void
+{
+    if (&other == this)
+    {
+        return;
+    }
+
+    m_cpu = other.m_cpu;
+    m_stack_hash = other.m_stack_hash;
+    m_random = other.m_random;
+    m_instruction_count = other.m_instruction_count;
+
+    m_memory = other.m_memory;
+    keep_spare_display();
+    m_display = other.m_display;
+    m_display_hash = other.m_display_hash;
+}
+
+auto Chip8::reset() -> void
+{
+    m_cpu = Cpu_State{};
+    m_stack_hash = 0;
+    m_instruction_count = 0;
+
+    m_memory.clear();
+    keep_spare_display();
+    m_display = get_blank_display();
+    m_display_hash = 0;
+
+    //Write font to memory from 0x50 to 0x9F
+    m_memory.write(FONTSET_START_ADDRESS, FONTS);
+}
+
+auto Chip8::seed_random(const std::uint64_t seed, const std::uint64_t stream) -> void
+{
+    m_random = Pcg32::seeded(seed, stream);
+}
+
+auto Chip8::read_rom(const std::filesystem::path& file_path) -> void
+{
+    //Mapped and written page by page instead of byte by byte
+    const Mapped_File rom(file_path);
+    load_rom(rom.get_bytes());
+}
+
+auto Chip8::load_rom(const std::span<const std::uint8_t> rom) -> void
+{
+    if (rom.size() > m_memory.size() - START_ADDRESS)
+    {
+        throw std::runtime_error("ROM size is to big for memory!");
+    }
+
+    m_memory.write(START_ADDRESS, rom);
+}
+
+template<bool Instrumented, typename Before_Execute>
+auto Chip8::step(Before_Execute before_execute) -> Decoded_Instruction
+{
+    if constexpr (Instrumented)
+    {
+        return step_instrumented(before_execute);
+    }
+
+    const auto opcode = fetch();
+
+    const auto nibbles = get_nibbles(opcode);
+    const auto instruction = decode(nibbles);
+
+    before_execute(instruction, nibbles);
+    execute(instruction, nibbles);
+
+    return {instruction, nibbles};
+}
+
+template<typename Before_Execute>
+auto Chip8::step_instrumented(Before_Execute before_execute) -> Decoded_Instruction
+{
+    const auto program_counter = m_cpu.program_counter;
+    const auto registers = m_cpu.registers;
+
+    if (m_debugger != nullptr)
+    {
+        m_debugger->before_instruction(*this);
+    }
+
+    std::uint16_t opcode{0}; //Stays 0 if the fetch itself faults
+    Decoded_Instruction decoded{};
+    try
+    {
+        opcode = fetch();
+
+        decoded.nibbles = get_nibbles(opcode);
+        decoded.instruction = decode(decoded.nibbles);
+
+        before_execute(decoded.instruction, decoded.nibbles);
+        execute(decoded.instruction, decoded.nibbles);
+    }
+    catch (...)
+    {
+        //The faulting instruction is the record most needed when comparing traces
+        record_trace(program_counter, opcode, registers, Trace_Record::FAULTED);
+        throw;
+    }
+
+    record_trace(program_counter, opcode, registers, 0);
+
+    if (m_debugger != nullptr)
+    {
+        m_debugger->after_instruction(*this);
+    }
+
+    return decoded;
+}
+
+auto Chip8::record_trace(const std::uint16_t program_counter, const std::uint16_t opcode,
+    const std::array<std::uint8_t, 16>& registers_before, const std::uint8_t flags) -> void
+{
+    if (m_tracer == nullptr)
+    {
+        return;
+    }
+
+    Trace_Record trace_record{
+        .program_counter = program_counter,
+        .opcode = opcode,
+        .index_register = m_cpu.index_register,
+        .changed_register = Trace_Record::NO_REGISTER,
+        .changed_value = 0,
+        .vf = m_cpu.registers[0xF],
+        .flags = flags,
+    };
+
+    for (std::uint8_t reg{0}; reg < 0xF; reg++)
+    {
+        if (m_cpu.registers[reg] != registers_before[reg])
+        {
+            trace_record.changed_register = reg;
+            trace_record.changed_value = m_cpu.registers[reg];
+            break;
+        }
+    }
+
+    m_tracer->record(trace_record);
+}
+
+auto Chip8::run_frame(const int instructions_per_frame) -> void
+{
+    if (is_instrumented())
+    {
+        int i{0};
+        for (; i < instructions_per_frame and m_run; i++)
+        {
+            step<true>(NO_HOOK);
+        }
+        m_instruction_count += i;
+        return;
+    }
+
+    for (int i{0}; i < instructions_per_frame; i++)
+    {
+        step<false>(NO_HOOK);
+    }
+    m_instruction_count += instructions_per_frame;
+}
+
+auto Chip8::update_timer() -> void
+{
+    if (m_cpu.delay_timer > 0)
+    {
+        m_cpu.delay_timer--;
+    }
+
+    if (m_cpu.sound_timer > 0)
+    {
+        m_cpu.sound_timer--;
+    }
+}
+
+auto Chip8::stop() -> void
+{
+    m_run = false;
+}
+
+auto Chip8::is_running() const -> bool
+{
+    return m_run;
+}
+
+auto Chip8::attach_debugger(Debugger* debugger) -> void
+{
+    m_debugger = debugger;
+}
+
+auto Chip8::attach_tracer(Tracer* tracer) -> void
+{
+    m_tracer = tracer;
+}
+
+auto Chip8::is_instrumented() const -> bool
+{
+    return m_tracer != nullptr or (m_debugger != nullptr and m_debugger->is_active());
+}
+
+auto Chip8::fetch() -> std::uint16_t
+{
+    const auto opcode_first_byte = m_memory.at(m_cpu.program_counter);
+    const auto opcode_second_byte = m_memory.at(m_cpu.program_counter + 1);
+
+    m_cpu.program_counter += 2;
+
+    std::uint16_t opcode{0};
+    opcode |= opcode_first_byte << 8;
+    opcode |= opcode_second_byte << 0;
+
+    return opcode;
+}
+
+auto Chip8::decode(const Nibbles nibbles) -> Instruction
+{
+    return core_decode(nibbles.first_nibble << 12 | nibbles.second_nibble << 8
+        | nibbles.third_nibble << 4 | nibbles.fourth_nibble);
+}
+
+auto Chip8::execute(const Instruction instruction, const Nibbles nibbles) -> void
+{
+    const std::uint16_t opcode = nibbles.first_nibble << 12 | nibbles.second_nibble << 8
+        | nibbles.third_nibble << 4 | nibbles.fourth_nibble;
+
+    Core_Access access{*this};
+    if (const auto status = core_execute(access, instruction, opcode); status != Core_Status::OK) [[unlikely]]
+    {
+        throw_core_status(status);
+    }
+}
+
+auto Chip8::save_state(std::ostream& out) const -> void
+{
+    const auto write_bytes = [&out](const auto* data, const std::size_t size)
+    {
+        out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    };
+
+    write_bytes(STATE_MAGIC.data(), STATE_MAGIC.size());
+    write_bytes(&STATE_VERSION, sizeof(STATE_VERSION));
+
+    write_bytes(m_cpu.registers.data(), m_cpu.registers.size());
+    write_bytes(&m_cpu.index_register, sizeof(m_cpu.index_register));
+    write_bytes(&m_cpu.program_counter, sizeof(m_cpu.program_counter));
+    write_bytes(&m_cpu.delay_timer, sizeof(m_cpu.delay_timer));
+    write_bytes(&m_cpu.sound_timer, sizeof(m_cpu.sound_timer));
+
+    //Stack is stored bottom to top
+    const auto stack_entries = get_call_stack();
+    const auto stack_size = static_cast<std::uint8_t>(stack_entries.size());
+    write_bytes(&stack_size, sizeof(stack_size));
+    write_bytes(stack_entries.data(), stack_entries.size() * sizeof(std::uint16_t));
+
+    std::array<std::uint8_t, Paged_Memory::SIZE> memory{};
+    m_memory.read(0, memory);
+    write_bytes(memory.data(), memory.size());
+    //Display as one byte per pixel, like before it was packed
+    std::array<std::uint8_t, DISPLAY_WIDTH * DISPLAY_HEIGHT> pixels{};
+    for (std::size_t index{0}; index < pixels.size(); index++)
+    {
+        pixels[index] = get_pixel(m_display->rows, index);
+    }
+    write_bytes(pixels.data(), pixels.size());
+    write_bytes(&m_random.state, sizeof(m_random.state));
+    write_bytes(&m_random.increment, sizeof(m_random.increment));
+
+    if (!out.good())
+    {
+        throw std::runtime_error("Failed to write state!");
+    }
+}
+
+auto Chip8::load_state(std::istream& in) -> void
+{
+    const auto read_bytes = [&in](auto* data, const std::size_t size)
+    {
+        in.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size));
+        if (!in.good())
+        {
+            throw std::runtime_error("State is truncated!");
+        }
+    };
+
+    std::array<char, 4> magic{};
+    std::uint8_t version{};
+    read_bytes(magic.data(), magic.size());
+    read_bytes(&version, sizeof(version));
+    if (magic != STATE_MAGIC or version < 1 or version > STATE_VERSION)
+    {
+        throw std::runtime_error("Unsupported state format!");
+    }
+
+    read_bytes(m_cpu.registers.data(), m_cpu.registers.size());
+    read_bytes(&m_cpu.index_register, sizeof(m_cpu.index_register));
+    read_bytes(&m_cpu.program_counter, sizeof(m_cpu.program_counter));
+    read_bytes(&m_cpu.delay_timer, sizeof(m_cpu.delay_timer));
+    read_bytes(&m_cpu.sound_timer, sizeof(m_cpu.sound_timer));
+
+    std::uint8_t stack_size{};
+    read_bytes(&stack_size, sizeof(stack_size));
+    if (stack_size > STACK_SIZE)
+    {
+        throw std::runtime_error("Unsupported state format!");
+    }
+    std::vector<std::uint16_t> stack_entries(stack_size);
+    read_bytes(stack_entries.data(), stack_entries.size() * sizeof(std::uint16_t));
+    m_cpu.stack_pointer = 0;
+    m_stack_hash = 0;
+    for (const auto entry: stack_entries)
+    {
+        m_stack_hash ^= zobrist_stack_key(m_cpu.stack_pointer, entry);
+        m_cpu.stack[m_cpu.stack_pointer++] = entry;
+    }
+
+    std::array<std::uint8_t, Paged_Memory::SIZE> memory{};
+    read_bytes(memory.data(), memory.size());
+    m_memory.write(0, memory);
+    std::array<std::uint8_t, DISPLAY_WIDTH * DISPLAY_HEIGHT> pixels{};
+    read_bytes(pixels.data(), pixels.size());
+
+    auto& display = get_writable_display();
+    display.fill(0);
+    m_display_hash = 0;
+    for (std::size_t index{0}; index < pixels.size(); index++)
+    {
+        if (pixels[index])
+        {
+            display[index / DISPLAY_WIDTH] |= get_pixel_mask(index);
+            m_display_hash ^= zobrist_pixel_key(index);
+        }
+    }
+
+    if (version >= 2)
+    {
+        read_bytes(&m_random.state, sizeof(m_random.state));
+        read_bytes(&m_random.increment, sizeof(m_random.increment));
+    }
+}
+
+auto Chip8::read_memory(const std::uint16_t address) const -> std::uint8_t
+{
+    return m_memory.at(address);
+}
+
+auto Chip8::write_memory(const std::uint16_t address, const std::uint8_t value) -> void
+{
+    m_memory.set(address, value);
+}
+
+auto Chip8::store_memory(const std::size_t address, const std::uint8_t value) -> void
+{
+    //Watchpoints see every store, also one that leaves the byte unchanged
+    if (m_debugger != nullptr and address < Paged_Memory::SIZE)
+    {
+        m_debugger->on_memory_write(*this, static_cast<std::uint16_t>(address), value);
+    }
+
+    m_memory.set(address, value);
+}
+
+auto Chip8::get_display() const -> const Display&
+{
+    return m_display->rows;
+}
+
+auto Chip8::get_memory() const -> const Paged_Memory&
+{
+    return m_memory;
+}
+
+auto Chip8::get_packed_display(const std::span<std::uint8_t, PACKED_DISPLAY_BYTES> packed_display) const -> void
+{
+    for (int byte{0}; byte < PACKED_DISPLAY_BYTES; byte++)
+    {
+        packed_display[byte] = static_cast<std::uint8_t>(m_display->rows[byte / 8] >> (56 - byte % 8 * 8));
+    }
+}
+
+auto Chip8::get_writable_display() -> Display&
+{
+    if (!is_exclusively_owned(m_display))
+    {
+        if (m_spare_display != nullptr)
+        {
+            *m_spare_display = *m_display;
+            m_display = std::move(m_spare_display);
+        }
+        else
+        {
+            m_display = std::make_shared<Display_Buffer>(*m_display);
+        }
+    }
+
+    return m_display->rows;
+}
+
+auto Chip8::keep_spare_display() -> void
+{
+    if (m_spare_display == nullptr and m_display != nullptr and is_exclusively_owned(m_display))
+    {
+        m_spare_display = std::move(m_display);
+    }
+}
+
+auto Chip8::get_registers() const -> const std::array<std::uint8_t, 16>&
+{
+    return m_cpu.registers;
+}
+
+auto Chip8::get_index_register() const -> std::uint16_t
+{
+    return m_cpu.index_register;
+}
+
+auto Chip8::get_program_counter() const -> std::uint16_t
+{
+    return m_cpu.program_counter;
+}
+
+auto Chip8::get_instruction_count() const -> std::uint64_t
+{
+    return m_instruction_count;
+}
+
+auto Chip8::get_delay_timer() const -> std::uint8_t
+{
+    return m_cpu.delay_timer;
+}
+
+auto Chip8::get_sound_timer() const -> std::uint8_t
+{
+    return m_cpu.sound_timer;
+}
+
+auto Chip8::get_call_stack() const -> std::vector<std::uint16_t>
+{
+    return {m_cpu.stack.begin(), m_cpu.stack.begin() + m_cpu.stack_pointer};
+}
+
+auto Chip8::press_key(const std::uint8_t key) -> void
+{
+    m_cpu.key_mask |= 1 << (key & 0xF);
+}
+
+auto Chip8::release_key(const std::uint8_t key) -> void
+{
+    m_cpu.key_mask &= ~(1 << (key & 0xF));
+}
+
+auto Chip8::set_key_mask(const std::uint16_t key_mask) -> void
+{
+    m_cpu.key_mask = key_mask;
+}
+
+auto Chip8::get_frame_hash() const -> std::uint64_t
+{
+    //FNV-1a over the display, the registers, I and PC
+    constexpr std::uint64_t FNV_OFFSET_BASIS{0xCBF29CE484222325};
+    constexpr std::uint64_t FNV_PRIME{0x100000001B3};
+
+    std::uint64_t hash{FNV_OFFSET_BASIS};
+    const auto add_byte = [&hash](const std::uint8_t byte)
+    {
+        hash ^= byte;
+        hash *= FNV_PRIME;
+    };
+
+    for (std::size_t index{0}; index < DISPLAY_WIDTH * DISPLAY_HEIGHT; index++)
+    {
+        add_byte(get_pixel(m_display->rows, index));
+    }
+
+    for (const auto reg: m_cpu.registers)
+    {
+        add_byte(reg);
+    }
+
+    add_byte(m_cpu.index_register >> 8);
+    add_byte(m_cpu.index_register & 0xFF);
+    add_byte(m_cpu.program_counter >> 8);
+    add_byte(m_cpu.program_counter & 0xFF);
+
+    return hash;
+}
+
+auto Chip8::get_state_hash() const -> std::uint64_t
+{
+    return zobrist_fold_cpu(m_memory.get_hash() ^ m_display_hash ^ m_stack_hash, m_cpu, m_random);
+}
+
+auto Chip8::compute_state_hash() const -> std::uint64_t
+{
+    std::array<std::uint8_t, Paged_Memory::SIZE> memory{};
+    m_memory.read(0, memory);
+
+    const auto hash = zobrist_memory_hash(memory) ^ zobrist_display_hash(m_display->rows)
+        ^ zobrist_stack_hash(std::span(m_cpu.stack).first(m_cpu.stack_pointer));
+    return zobrist_fold_cpu(hash, m_cpu, m_random);
+}
+
+auto Chip8::get_nibbles(const std::uint16_t instruction) -> Nibbles
+{
+    const Nibbles nibbles{
+        .first_nibble = static_cast<std::uint8_t>((instruction & 0xF000) >> 12),
+        .second_nibble = static_cast<std::uint8_t>((instruction & 0x0F00) >> 8),
+        .third_nibble = static_cast<std::uint8_t>((instruction & 0x00F0) >> 4),
+        .fourth_nibble = static_cast<std::uint8_t>((instruction & 0x000F) >> 0),
+    };
+
+    return nibbles;
+}
+
+auto COSMAC_VIP::fork() const -> std::unique_ptr<Chip8>
+{
+    return std::unique_ptr<Chip8>(new COSMAC_VIP(*this));
+}
+
+auto COSMAC_VIP::set_timing_model(const Timing_Model& timing_model) -> void
+{
+    if (timing_model.cycles_per_frame <= 0)
+    {
+        throw std::invalid_argument("Cycles per frame must be a positive number!");
+    }
+
+    m_timing_model = timing_model;
+    m_cycle_overrun = 0;
+}
+
+auto COSMAC_VIP::run_frame(const int instructions_per_frame) -> void
+{
+    if (!m_timing_model.enabled)
+    {
+        Chip8::run_frame(instructions_per_frame);
+        return;
+    }
+
+    if (is_instrumented())
+    {
+        run_cycle_budget<true>();
+        return;
+    }
+
+    run_cycle_budget<false>();
+}
+
+template<bool Instrumented>
+auto COSMAC_VIP::run_cycle_budget() -> void
+{
+    //Instructions are charged their VIP cost until the frame budget is spent,
+    //instructions_per_frame is ignored in this mode
+    int cycles = m_cycle_overrun;
+    while (cycles < m_timing_model.cycles_per_frame and (!Instrumented or m_run))
+    {
+        const auto program_counter = m_cpu.program_counter;
+        //Read before the instruction runs, DXYN with X = F overwrites VX with the collision flag
+        std::uint8_t sprite_x{};
+        const auto [instruction, nibbles] = step<Instrumented>([&](const Instruction decoded, const Nibbles decoded_nibbles)
+        {
+            if (decoded == Instruction::I_DXYN)
+            {
+                sprite_x = m_cpu.registers[decoded_nibbles.second_nibble];
+            }
+        });
+        m_instruction_count++;
+
+        cycles += get_instruction_cycles(instruction, nibbles, sprite_x);
+        if (is_skip_instruction(instruction) and m_cpu.program_counter == program_counter + 4)
+        {
+            cycles += SKIP_TAKEN_CYCLES;
+        }
+
+        //The VIP interpreter prepares the sprite, then waits for the next display interrupt to draw it
+        if (instruction == Instruction::I_DXYN and m_timing_model.display_wait)
+        {
+            cycles = std::max(cycles, m_timing_model.cycles_per_frame);
+        }
+    }
+
+    //A frame cut short by stop() did not run into the next one
+    m_cycle_overrun = std::max(cycles - m_timing_model.cycles_per_frame, 0);
+}
+
+auto COSMAC_VIP::get_instruction_cycles(const Instruction instruction, const Nibbles nibbles,
+    const std::uint8_t sprite_x) -> int
+{
+    const auto [base, per_unit] = INSTRUCTION_TIMINGS[static_cast<std::size_t>(instruction)];
+    if (per_unit == 0)
+    {
+        return base;
+    }
+
+    if (instruction == Instruction::I_DXYN)
+    {
+        return base + (per_unit + SPRITE_SHIFT_CYCLES * (sprite_x & 7)) * nibbles.fourth_nibble;
+    }
+
+    return base + per_unit * (nibbles.second_nibble + 1);
+}
+
+auto COSMAC_VIP::is_skip_instruction(const Instruction instruction) -> bool
+{
+    switch (instruction)
+    {
+    case Instruction::I_3XNN:
+    case Instruction::I_4XNN:
+    case Instruction::I_5XY0:
+    case Instruction::I_9XY0:
+    case Instruction::I_EX9E:
+    case Instruction::I_EXA1:
+        return true;
+    default:
+        return false;
+    }
+}
+
+auto CHIP_48::fork() const -> std::unique_ptr<Chip8>
+{
+    return std::unique_ptr<Chip8>(new CHIP_48(*this));
+}
@@ -0,0 +1,117 @@
+//
+// Embeddable interpreter core without allocations, exceptions or threads.
+//
+
+#include <cstring>
+
+#include "chip8_core.h"
+
+
+namespace
+{
+    //The machine core_execute runs on: the flat arrays of a Core_State, nothing to keep up to date
+    class Flat_Access
+    {
+    public:
+        explicit Flat_Access(Core_State& state) noexcept: m_state{state}
+        {
+        }
+
+        auto cpu() noexcept -> Core_State& { return m_state; }
+        auto random() noexcept -> Pcg32& { return m_state.random; }
+        auto load(const int address) const noexcept -> std::uint8_t { return m_state.memory[address]; }
+        auto store(const int address, const std::uint8_t value) noexcept -> void { m_state.memory[address] = value; }
+        auto clear_display() noexcept -> void { m_state.display.fill(0); }
+        auto display() noexcept -> std::array<std::uint64_t, CORE_DISPLAY_HEIGHT>& { return m_state.display; }
+        auto pixel_flipped(int) noexcept -> void {}
+        auto stack_changed(int, std::uint16_t) noexcept -> void {}
+
+    private:
+        Core_State& m_state;
+    };
+}
+
+
+auto core_reset(Core_State& state, const std::uint64_t seed, const std::uint64_t stream) noexcept -> void
+{
+    state = Core_State{};
+    std::memcpy(state.memory.data() + CORE_FONTSET_START_ADDRESS, CORE_FONTS.data(), CORE_FONTS.size());
+    state.program_counter = CORE_START_ADDRESS;
+    state.random = Pcg32::seeded(seed, stream);
+}
+
+auto core_load_rom(Core_State& state, const std::span<const std::uint8_t> rom) noexcept -> Core_Status
+{
+    if (rom.size() > CORE_MEMORY_SIZE - CORE_START_ADDRESS)
+    {
+        return Core_Status::ROM_TOO_LARGE;
+    }
+
+    std::memcpy(state.memory.data() + CORE_START_ADDRESS, rom.data(), rom.size());
+    return Core_Status::OK;
+}
+
+auto core_step(Core_State& state) noexcept -> Core_Status
+{
+    auto& PC = state.program_counter;
+    if (PC + 1 >= CORE_MEMORY_SIZE)
+    {
+        return Core_Status::MEMORY_OUT_OF_RANGE;
+    }
+
+    const std::uint16_t opcode = state.memory[PC] << 8 | state.memory[PC + 1];
+    PC += 2;
+
+    Flat_Access access{state};
+    return core_execute(access, core_decode(opcode), opcode);
+}
+
+auto core_step_frame(Core_State& state, const int instructions_per_frame) noexcept -> Core_Status
+{
+    for (int i{0}; i < instructions_per_frame; i++)
+    {
+        if (const auto status = core_step(state); status != Core_Status::OK)
+        {
+            return status;
+        }
+        state.instruction_count++;
+    }
+
+    if (state.delay_timer > 0)
+    {
+        state.delay_timer--;
+    }
+
+    if (state.sound_timer > 0)
+    {
+        state.sound_timer--;
+    }
+
+    return Core_Status::OK;
+}
+
+auto core_get_packed_display(const Core_State& state,
+    const std::span<std::uint8_t, CORE_PACKED_DISPLAY_BYTES> packed_display) noexcept -> void
+{
+    for (int row{0}; row < CORE_DISPLAY_HEIGHT; row++)
+    {
+        for (int byte{0}; byte < 8; byte++)
+        {
+            packed_display[row * 8 + byte] = state.display[row] >> (56 - byte * 8) & 0xFF;
+        }
+    }
+}
+
+auto core_get_status_name(const Core_Status status) noexcept -> const char*
+{
+    switch (status)
+    {
+    case Core_Status::OK: return "OK";
+    case Core_Status::INVALID_INSTRUCTION: return "Invalid instruction";
+    case Core_Status::MEMORY_OUT_OF_RANGE: return "Memory address out of range";
+    case Core_Status::STACK_OVERFLOW: return "Stack overflow";
+    case Core_Status::STACK_UNDERFLOW: return "Stack underflow";
+    case Core_Status::ROM_TOO_LARGE: return "ROM size is too big for memory";
+    default: return "Unknown status";
+    }
+}
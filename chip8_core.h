@@ -0,0 +1,367 @@
+//
+// Embeddable interpreter core without allocations, exceptions or threads.
+//
+
+#ifndef CHIP8_CORE_H
+#define CHIP8_CORE_H
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+#include "pcg32.h"
+
+
+inline constexpr std::array<std::uint8_t, 80> CORE_FONTS
+{
+    0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+    0x20, 0x60, 0x20, 0x20, 0x70, // 1
+    0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+    0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+    0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+    0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+    0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+    0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+    0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+    0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+    0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+    0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+    0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+    0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+    0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+    0xF0, 0x80, 0xF0, 0x80, 0x80, // F
+};
+
+inline constexpr std::uint16_t CORE_START_ADDRESS{0x200};
+inline constexpr std::uint16_t CORE_FONTSET_START_ADDRESS{0x50};
+inline constexpr int CORE_MEMORY_SIZE{4096};
+inline constexpr int CORE_STACK_SIZE{16};
+inline constexpr int CORE_DISPLAY_WIDTH{64};
+inline constexpr int CORE_DISPLAY_HEIGHT{32};
+inline constexpr int CORE_PACKED_DISPLAY_BYTES{CORE_DISPLAY_WIDTH * CORE_DISPLAY_HEIGHT / 8};
+
+
+enum class Core_Status: std::uint8_t
+{
+    OK,
+    INVALID_INSTRUCTION,
+    MEMORY_OUT_OF_RANGE,
+    STACK_OVERFLOW,
+    STACK_UNDERFLOW,
+    ROM_TOO_LARGE,
+};
+
+//Also Chip8::Instruction, the values index the instruction tables of the debugger and the VIP timing
+enum class Core_Instruction: std::uint8_t
+{
+    I_00E0 = 0, I_00EE = 1,
+    I_1NNN = 2,
+    I_2NNN = 3,
+    I_3XNN = 4,
+    I_4XNN = 5,
+    I_5XY0 = 6,
+    I_6XNN = 7,
+    I_7XNN = 8,
+    I_8XY0 = 9, I_8XY1 = 10, I_8XY2 = 11, I_8XY3 = 12, I_8XY4 = 13,
+    I_8XY5 = 14, I_8XY7 = 15, I_8XY6 = 16, I_8XYE = 17,
+    I_9XY0 = 18,
+    I_ANNN = 19,
+    I_BNNN = 20,
+    I_CXNN = 21,
+    I_DXYN = 22,
+    I_EX9E = 23, I_EXA1 = 24,
+    I_FX07 = 25, I_FX15 = 26, I_FX18 = 27, I_FX1E = 28, I_FX0A = 29,
+    I_FX29 = 30, I_FX33 = 31, I_FX55 = 32, I_FX65 = 33,
+    UNINITIALIZED = 34, //Not a valid instruction
+};
+
+
+/*
+ * The whole machine in one trivially copyable struct: copying it forks the machine,
+ * writing its bytes out saves it. Display rows are one word each, the most
+ * significant bit is the leftmost pixel.
+ */
+struct Core_State
+{
+    std::array<std::uint8_t, CORE_MEMORY_SIZE> memory;
+    std::array<std::uint64_t, CORE_DISPLAY_HEIGHT> display;
+    std::array<std::uint8_t, 16> registers;
+    std::array<std::uint16_t, CORE_STACK_SIZE> stack;
+    std::uint16_t index_register;
+    std::uint16_t program_counter;
+    std::uint8_t stack_pointer;
+    std::uint8_t delay_timer;
+    std::uint8_t sound_timer;
+    std::uint16_t key_mask; //Bit n set while key n is held
+    Pcg32 random;
+    std::uint64_t instruction_count;
+};
+
+static_assert(std::is_trivially_copyable_v<Core_State> and std::is_standard_layout_v<Core_State>);
+
+
+/*
+ * The instructions are the same code as in Chip8, see core_execute. Where Chip8 throws,
+ * the core returns a status instead and stops: the program counter is then already past
+ * the faulting instruction, which may have partially executed.
+ */
+auto core_reset(Core_State& state, std::uint64_t seed, std::uint64_t stream = 0) noexcept -> void;
+auto core_load_rom(Core_State& state, std::span<const std::uint8_t> rom) noexcept -> Core_Status;
+auto core_step(Core_State& state) noexcept -> Core_Status;
+//Runs the instructions of one frame, then counts the timers down if all of them succeeded
+auto core_step_frame(Core_State& state, int instructions_per_frame) noexcept -> Core_Status;
+
+auto core_get_packed_display(const Core_State& state, std::span<std::uint8_t, CORE_PACKED_DISPLAY_BYTES> packed_display) noexcept -> void;
+[[nodiscard]] auto core_get_status_name(Core_Status status) noexcept -> const char*;
+
+
+//Like Chip8 the unused nibbles of 00E0, 00EE and 5XY0/9XY0 are not checked
+[[nodiscard]] constexpr auto core_decode(const std::uint16_t opcode) noexcept -> Core_Instruction
+{
+    using enum Core_Instruction;
+
+    switch (opcode >> 12)
+    {
+    case 0x0:
+        if ((opcode & 0xFF) == 0xE0) return I_00E0;
+        if ((opcode & 0xFF) == 0xEE) return I_00EE;
+        return UNINITIALIZED;
+    case 0x1: return I_1NNN;
+    case 0x2: return I_2NNN;
+    case 0x3: return I_3XNN;
+    case 0x4: return I_4XNN;
+    case 0x5: return I_5XY0;
+    case 0x6: return I_6XNN;
+    case 0x7: return I_7XNN;
+    case 0x8:
+        switch (opcode & 0xF)
+        {
+        case 0x0: return I_8XY0;
+        case 0x1: return I_8XY1;
+        case 0x2: return I_8XY2;
+        case 0x3: return I_8XY3;
+        case 0x4: return I_8XY4;
+        case 0x5: return I_8XY5;
+        case 0x6: return I_8XY6;
+        case 0x7: return I_8XY7;
+        case 0xE: return I_8XYE;
+        default: return UNINITIALIZED;
+        }
+    case 0x9: return I_9XY0;
+    case 0xA: return I_ANNN;
+    case 0xB: return I_BNNN;
+    case 0xC: return I_CXNN;
+    case 0xD: return I_DXYN;
+    case 0xE:
+        if ((opcode & 0xFF) == 0x9E) return I_EX9E;
+        if ((opcode & 0xFF) == 0xA1) return I_EXA1;
+        return UNINITIALIZED;
+    default:
+        switch (opcode & 0xFF)
+        {
+        case 0x07: return I_FX07;
+        case 0x15: return I_FX15;
+        case 0x18: return I_FX18;
+        case 0x1E: return I_FX1E;
+        case 0x0A: return I_FX0A;
+        case 0x29: return I_FX29;
+        case 0x33: return I_FX33;
+        case 0x55: return I_FX55;
+        case 0x65: return I_FX65;
+        default: return UNINITIALIZED;
+        }
+    }
+}
+
+
+/*
+ * Runs a decoded instruction, the program counter already points past it. This is the
+ * only implementation of the instruction set: core_step runs it on the flat memory of a
+ * Core_State and Chip8::execute on its copy-on-write pages. Machine gives access to the state:
+ *
+ *   cpu()                          registers, stack, I, PC, timers and keys, named like in Core_State
+ *   random()                       Pcg32 for CXNN
+ *   load(address)                  memory byte, the address is below CORE_MEMORY_SIZE
+ *   store(address, value)          same for writes
+ *   clear_display()
+ *   display()                      writable display rows, the most significant bit is the leftmost pixel
+ *   pixel_flipped(index)           after DXYN flipped the row major pixel index of display()
+ *   stack_changed(depth, address)  after 2NNN pushed or 00EE popped the return address at depth
+ *
+ * A status other than OK stops the instruction at the fault, earlier writes stay.
+ */
+template<typename Machine>
+constexpr auto core_execute(Machine& machine, const Core_Instruction instruction, const std::uint16_t opcode)
+    -> Core_Status
+{
+    using enum Core_Instruction;
+
+    auto& cpu = machine.cpu();
+    auto& V = cpu.registers;
+    auto& PC = cpu.program_counter;
+    auto& I = cpu.index_register;
+
+    const std::uint8_t x = opcode >> 8 & 0xF;
+    const std::uint8_t y = opcode >> 4 & 0xF;
+    const std::uint8_t n = opcode & 0xF;
+    const std::uint8_t nn = opcode & 0xFF;
+    const std::uint16_t nnn = opcode & 0xFFF;
+
+    //The flag of 8XY4-8XYE is written after the result, so it wins when X is F
+    const std::uint8_t vx = V[x];
+    const std::uint8_t vy = V[y];
+
+    switch (instruction)
+    {
+    case I_00E0: machine.clear_display(); return Core_Status::OK;
+
+    case I_00EE:
+        if (cpu.stack_pointer == 0)
+        {
+            return Core_Status::STACK_UNDERFLOW;
+        }
+        PC = cpu.stack[--cpu.stack_pointer];
+        machine.stack_changed(cpu.stack_pointer, PC);
+        return Core_Status::OK;
+
+    case I_1NNN: PC = nnn; return Core_Status::OK;
+
+    case I_2NNN:
+        if (cpu.stack_pointer == CORE_STACK_SIZE)
+        {
+            return Core_Status::STACK_OVERFLOW;
+        }
+        machine.stack_changed(cpu.stack_pointer, PC);
+        cpu.stack[cpu.stack_pointer++] = PC;
+        PC = nnn;
+        return Core_Status::OK;
+
+    case I_3XNN: if (vx == nn) PC += 2; return Core_Status::OK;
+    case I_4XNN: if (vx != nn) PC += 2; return Core_Status::OK;
+    case I_5XY0: if (vx == vy) PC += 2; return Core_Status::OK;
+    case I_9XY0: if (vx != vy) PC += 2; return Core_Status::OK;
+    case I_6XNN: V[x] = nn; return Core_Status::OK;
+    case I_7XNN: V[x] = vx + nn; return Core_Status::OK;
+
+    case I_8XY0: V[x] = vy; return Core_Status::OK;
+    case I_8XY1: V[x] = vx | vy; return Core_Status::OK;
+    case I_8XY2: V[x] = vx & vy; return Core_Status::OK;
+    case I_8XY3: V[x] = vx ^ vy; return Core_Status::OK;
+    case I_8XY4: V[x] = vx + vy; V[0xF] = vx + vy > 0xFF; return Core_Status::OK;
+    case I_8XY5: V[x] = vx - vy; V[0xF] = vx >= vy; return Core_Status::OK;
+    case I_8XY7: V[x] = vy - vx; V[0xF] = vy >= vx; return Core_Status::OK;
+    case I_8XY6: V[x] = vx >> 1; V[0xF] = vx & 0x01; return Core_Status::OK;
+    case I_8XYE: V[x] = vx << 1; V[0xF] = vx >> 7; return Core_Status::OK;
+
+    case I_ANNN: I = nnn; return Core_Status::OK;
+    case I_BNNN: PC = V[0x0] + nnn; return Core_Status::OK;
+    case I_CXNN: V[x] = machine.random().next_byte() & nn; return Core_Status::OK;
+
+    case I_DXYN:
+    {
+        auto& display = machine.display();
+        const int left = vx % CORE_DISPLAY_WIDTH;
+        const int top = vy % CORE_DISPLAY_HEIGHT;
+        V[0xF] = 0;
+
+        //Pixels past the right edge continue on the next row and drawing ends at the first pixel past the bottom
+        for (int row{0}; row < n; row++)
+        {
+            const int address = I + row;
+            if (address >= CORE_MEMORY_SIZE)
+            {
+                return Core_Status::MEMORY_OUT_OF_RANGE;
+            }
+
+            const std::uint8_t sprite_byte = machine.load(address);
+            for (int column{0}; column < 8; column++)
+            {
+                const int index = (top + row) * CORE_DISPLAY_WIDTH + left + column;
+                if (index >= CORE_DISPLAY_WIDTH * CORE_DISPLAY_HEIGHT)
+                {
+                    return Core_Status::OK;
+                }
+
+                if (sprite_byte & 0x80 >> column)
+                {
+                    auto& display_row = display[index / CORE_DISPLAY_WIDTH];
+                    const std::uint64_t pixel = std::uint64_t{1} << (CORE_DISPLAY_WIDTH - 1 - index % CORE_DISPLAY_WIDTH);
+                    if (display_row & pixel)
+                    {
+                        V[0xF] = 1;
+                    }
+                    display_row ^= pixel;
+                    machine.pixel_flipped(index);
+                }
+            }
+        }
+        return Core_Status::OK;
+    }
+
+    case I_EX9E: if (cpu.key_mask >> (vx & 0xF) & 1) PC += 2; return Core_Status::OK;
+    case I_EXA1: if (!(cpu.key_mask >> (vx & 0xF) & 1)) PC += 2; return Core_Status::OK;
+
+    case I_FX07: V[x] = cpu.delay_timer; return Core_Status::OK;
+    case I_FX15: cpu.delay_timer = vx; return Core_Status::OK;
+    case I_FX18: cpu.sound_timer = vx; return Core_Status::OK;
+    case I_FX1E: I += vx; return Core_Status::OK;
+    case I_FX29: I = CORE_FONTSET_START_ADDRESS + 5 * vx; return Core_Status::OK;
+
+    case I_FX0A:
+        //Waits by running the same instruction again until a key is held
+        if (cpu.key_mask != 0)
+        {
+            V[x] = static_cast<std::uint8_t>(std::countr_zero(cpu.key_mask));
+        }
+        else
+        {
+            PC -= 2;
+        }
+        return Core_Status::OK;
+
+    case I_FX33:
+    {
+        std::uint8_t number = vx;
+        for (int digit{2}; digit >= 0; digit--)
+        {
+            if (I + digit >= CORE_MEMORY_SIZE)
+            {
+                return Core_Status::MEMORY_OUT_OF_RANGE;
+            }
+            machine.store(I + digit, number % 10);
+            number /= 10;
+        }
+        return Core_Status::OK;
+    }
+
+    case I_FX55:
+        for (int reg{0}; reg <= x; reg++)
+        {
+            if (I + reg >= CORE_MEMORY_SIZE)
+            {
+                return Core_Status::MEMORY_OUT_OF_RANGE;
+            }
+            machine.store(I + reg, V[reg]);
+        }
+        return Core_Status::OK;
+
+    case I_FX65:
+        for (int reg{0}; reg <= x; reg++)
+        {
+            if (I + reg >= CORE_MEMORY_SIZE)
+            {
+                return Core_Status::MEMORY_OUT_OF_RANGE;
+            }
+            V[reg] = machine.load(I + reg);
+        }
+        return Core_Status::OK;
+
+    case UNINITIALIZED:
+    default:
+        return Core_Status::INVALID_INSTRUCTION;
+    }
+}
+
+#endif //CHIP8_CORE_H
@@ -0,0 +1,202 @@
+//
+// Headless conformance runner for test ROM suites.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include "conformance.h"
+#include "main.h"
+
+
+auto parse_conformance_manifest(const std::filesystem::path& manifest_path)
+    -> std::vector<Conformance_Case>
+{
+    std::ifstream manifest(manifest_path);
+    if (!manifest.good())
+    {
+        throw std::runtime_error("Failed to open conformance manifest!");
+    }
+
+    std::vector<Conformance_Case> cases;
+    std::string line;
+    while (std::getline(manifest, line))
+    {
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream tokens(line);
+        std::string rom;
+        if (!(tokens >> rom))
+        {
+            continue;
+        }
+
+        Conformance_Case conformance_case;
+        conformance_case.rom_path = manifest_path.parent_path() / rom;
+        if (!(tokens >> conformance_case.instructions_per_frame))
+        {
+            throw std::runtime_error("Manifest entry for " + rom + " is missing instructions per frame!");
+        }
+
+        std::string token;
+        while (tokens >> token)
+        {
+            if (token == "vip")
+            {
+                conformance_case.vip_timing = true;
+                continue;
+            }
+
+            const auto separator = token.find(':');
+            if (separator == std::string::npos)
+            {
+                throw std::runtime_error("Invalid manifest token " + token + "!");
+            }
+
+            const auto value = token.substr(separator + 1);
+            if (token.front() == 'k')
+            {
+                conformance_case.key_presses.push_back({
+                    .frame = std::stoi(token.substr(1, separator - 1)),
+                    .key = static_cast<std::uint8_t>(std::stoi(value, nullptr, 16) & 0xF),
+                });
+                continue;
+            }
+
+            Conformance_Check check{.frame = std::stoi(token.substr(0, separator))};
+            if (value == "?")
+            {
+                check.record = true;
+            }
+            else
+            {
+                check.expected_hash = std::stoull(value, nullptr, 16);
+            }
+            conformance_case.checks.push_back(check);
+        }
+
+        std::ranges::sort(conformance_case.checks, {}, &Conformance_Check::frame);
+        cases.push_back(std::move(conformance_case));
+    }
+
+    return cases;
+}
+
+auto run_conformance_case(const Conformance_Case& conformance_case) -> Conformance_Result
+{
+    Conformance_Result result;
+    if (conformance_case.checks.empty())
+    {
+        return result;
+    }
+
+    std::unique_ptr<Chip8> chip8;
+    if (conformance_case.vip_timing)
+    {
+        auto cosmac_vip = std::make_unique<COSMAC_VIP>();
+        cosmac_vip->set_timing_model({.enabled = true});
+        chip8 = std::move(cosmac_vip);
+    }
+    else
+    {
+        chip8 = std::make_unique<Chip8>();
+    }
+
+    std::ostringstream message;
+    try
+    {
+        chip8->read_rom(conformance_case.rom_path);
+
+        auto check = conformance_case.checks.begin();
+        for (int frame{1}; check != conformance_case.checks.end(); frame++)
+        {
+            for (const auto& [press_frame, key]: conformance_case.key_presses)
+            {
+                if (press_frame == frame)
+                {
+                    chip8->press_key(key);
+                }
+            }
+
+            chip8->run_frame(conformance_case.instructions_per_frame);
+            chip8->update_timer();
+
+            for (const auto& [press_frame, key]: conformance_case.key_presses)
+            {
+                if (press_frame == frame)
+                {
+                    chip8->release_key(key);
+                }
+            }
+
+            for (; check != conformance_case.checks.end() and check->frame == frame; ++check)
+            {
+                const auto hash = chip8->get_frame_hash();
+                if (check->record)
+                {
+                    message << "\n\tframe " << frame << ": " << std::hex << hash << std::dec;
+                }
+                else if (hash != check->expected_hash)
+                {
+                    result.passed = false;
+                    message << "\n\tframe " << frame << ": expected " << std::hex
+                        << check->expected_hash << ", got " << hash << std::dec;
+                }
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        result.passed = false;
+        message << "\n\t" << e.what();
+    }
+
+    result.message = message.str();
+    return result;
+}
+
+auto run_conformance_suite(const std::filesystem::path& manifest_path) -> bool
+{
+    const auto cases = parse_conformance_manifest(manifest_path);
+    if (cases.empty())
+    {
+        throw std::runtime_error("Conformance manifest has no cases!");
+    }
+
+    std::vector<Conformance_Result> results(cases.size());
+
+    //Every worker picks the next unclaimed case until the suite is done
+    std::atomic_size_t next_case{0};
+    const auto worker = [&]
+    {
+        for (auto i = next_case++; i < cases.size(); i = next_case++)
+        {
+            results.at(i) = run_conformance_case(cases.at(i));
+        }
+    };
+
+    const auto worker_count = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, cases.size());
+    {
+        std::vector<std::jthread> workers;
+        for (std::size_t i{0}; i < worker_count; i++)
+        {
+            workers.emplace_back(worker);
+        }
+    }
+
+    bool all_passed{true};
+    for (std::size_t i{0}; i < cases.size(); i++)
+    {
+        const auto& [passed, message] = results.at(i);
+        std::printf("%s %s%s\n", passed ? "PASS" : "FAIL",
+            cases.at(i).rom_path.string().c_str(), message.c_str());
+        all_passed = all_passed and passed;
+    }
+
+    std::printf("%zu cases, %s\n", cases.size(), all_passed ? "all passed" : "failures");
+    return all_passed;
+}
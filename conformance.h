@@ -0,0 +1,55 @@
+//
+// Headless conformance runner for test ROM suites.
+//
+
+#ifndef CONFORMANCE_H
+#define CONFORMANCE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+
+struct Conformance_Check
+{
+    int frame{};
+    std::uint64_t expected_hash{};
+    bool record{false}; //Golden value unknown, print the computed one
+};
+
+struct Conformance_Key_Press
+{
+    int frame{};
+    std::uint8_t key{};
+};
+
+struct Conformance_Case
+{
+    std::filesystem::path rom_path{};
+    int instructions_per_frame{11};
+    bool vip_timing{false};
+    std::vector<Conformance_Check> checks{};
+    std::vector<Conformance_Key_Press> key_presses{};
+};
+
+struct Conformance_Result
+{
+    bool passed{true};
+    std::string message{};
+};
+
+/*
+ * Manifest format, one ROM per line, '#' starts a comment:
+ *
+ *   path/to/rom.ch8 <instructions per frame> [vip] [k<frame>:<key>...] <frame>:<hash>...
+ *
+ * Relative ROM paths are resolved against the manifest directory. A key is held
+ * down during the given frame only. A hash of "?" records the computed value.
+ */
+[[nodiscard]] auto parse_conformance_manifest(const std::filesystem::path& manifest_path)
+    -> std::vector<Conformance_Case>;
+[[nodiscard]] auto run_conformance_case(const Conformance_Case& conformance_case) -> Conformance_Result;
+[[nodiscard]] auto run_conformance_suite(const std::filesystem::path& manifest_path) -> bool;
+
+#endif //CONFORMANCE_H
@@ -0,0 +1,395 @@
+//
+// Unix domain socket control server with a shared memory framebuffer.
+//
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "control_server.h"
+#include "frame_exporter.h"
+
+
+auto remove_socket_file(const std::filesystem::path& socket_path) noexcept -> bool
+{
+    struct stat status{};
+    if (lstat(socket_path.c_str(), &status) != 0)
+    {
+        return errno == ENOENT;
+    }
+
+    if (!S_ISSOCK(status.st_mode))
+    {
+        return false;
+    }
+
+    return unlink(socket_path.c_str()) == 0 or errno == ENOENT;
+}
+
+
+Control_Server::Control_Server(std::filesystem::path socket_path, const int instructions_per_frame,
+    const bool vip_timing, const std::uint64_t seed)
+    : m_socket_path(std::move(socket_path)),
+      m_shared_memory_name("/chip8-" + std::to_string(getpid())),
+      m_instructions_per_frame(instructions_per_frame),
+      m_vip_timing(vip_timing),
+      m_seed(seed)
+{
+    //The destructor does not run when the constructor throws, so whatever was set up is released here
+    try
+    {
+        open_resources();
+    }
+    catch (...)
+    {
+        close_resources();
+        throw;
+    }
+
+    m_chip8 = std::make_unique<Chip8>();
+    m_chip8->seed_random(m_seed);
+}
+
+Control_Server::~Control_Server()
+{
+    close_resources();
+}
+
+auto Control_Server::load_rom(const std::filesystem::path& rom_path) -> void
+{
+    std::unique_ptr<Chip8> chip8;
+    if (m_vip_timing)
+    {
+        auto cosmac_vip = std::make_unique<COSMAC_VIP>();
+        cosmac_vip->set_timing_model({.enabled = true});
+        chip8 = std::move(cosmac_vip);
+    }
+    else
+    {
+        chip8 = std::make_unique<Chip8>();
+    }
+
+    chip8->seed_random(m_seed);
+    chip8->read_rom(rom_path);
+    m_chip8 = std::move(chip8);
+    publish_frame();
+}
+
+auto Control_Server::attach_frame_exporter(Frame_Exporter* frame_exporter) -> void
+{
+    m_frame_exporter = frame_exporter;
+}
+
+auto Control_Server::run() -> void
+{
+    std::printf("Listening on %s, framebuffer in shared memory %s\n",
+        m_socket_path.c_str(), m_shared_memory_name.c_str());
+    std::fflush(stdout);
+
+    while (m_run)
+    {
+        const int client_fd = accept4(m_socket_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client_fd < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::runtime_error("Failed to accept control connection!");
+        }
+
+        handle_client(client_fd);
+        close(client_fd);
+    }
+}
+
+auto Control_Server::handle_client(const int client_fd) -> void
+{
+    m_client_connected = true;
+
+    std::string pending;
+    std::array<char, 4096> buffer{};
+    while (m_run and m_client_connected)
+    {
+        const auto received = recv(client_fd, buffer.data(), buffer.size(), 0);
+        if (received <= 0)
+        {
+            return;
+        }
+        pending.append(buffer.data(), received);
+
+        for (auto newline = pending.find('\n'); newline != std::string::npos; newline = pending.find('\n'))
+        {
+            auto line = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+            if (!line.empty() and line.back() == '\r')
+            {
+                line.pop_back();
+            }
+
+            const auto response = handle_command(line) + '\n';
+            if (send(client_fd, response.data(), response.size(), MSG_NOSIGNAL) < 0)
+            {
+                return;
+            }
+        }
+    }
+}
+
+auto Control_Server::handle_command(const std::string& line) -> std::string
+{
+    std::istringstream tokens(line);
+    std::string command;
+    tokens >> command;
+
+    const auto read_hex = [&tokens](const char* name) -> unsigned long
+    {
+        std::string value;
+        if (!(tokens >> value))
+        {
+            throw std::invalid_argument(std::string("Missing ") + name);
+        }
+        return std::stoul(value, nullptr, 16);
+    };
+
+    //Addresses are narrowed to 16 bits further down, 10200 must not end up at 200
+    const auto check_range = [](const unsigned long address, const unsigned long length)
+    {
+        if (address >= Paged_Memory::SIZE or length > Paged_Memory::SIZE - address)
+        {
+            throw std::out_of_range("Address out of range");
+        }
+    };
+
+    const auto read_path = [&tokens]() -> std::filesystem::path
+    {
+        std::string path;
+        std::getline(tokens >> std::ws, path);
+        if (path.empty())
+        {
+            throw std::invalid_argument("Missing path");
+        }
+        return path;
+    };
+
+    try
+    {
+        std::ostringstream response;
+        response << "OK";
+
+        if (command == "info")
+        {
+            response << ' ' << m_shared_memory_name << ' ' << m_framebuffer->sequence / 2;
+        }
+        else if (command == "load")
+        {
+            load_rom(read_path());
+        }
+        else if (command == "seed")
+        {
+            std::string seed;
+            std::uint64_t stream{0};
+            if (!(tokens >> seed))
+            {
+                throw std::invalid_argument("Missing seed");
+            }
+            tokens >> stream;
+
+            m_seed = std::stoull(seed, nullptr, 0);
+            m_chip8->seed_random(m_seed, stream);
+        }
+        else if (command == "step")
+        {
+            int frames{1};
+            tokens >> frames;
+            for (int frame{0}; frame < frames; frame++)
+            {
+                m_chip8->run_frame(m_instructions_per_frame);
+                m_chip8->update_timer();
+                publish_frame();
+
+                if (m_frame_exporter != nullptr)
+                {
+                    std::array<std::uint8_t, Chip8::PACKED_DISPLAY_BYTES> packed_display{};
+                    m_chip8->get_packed_display(packed_display);
+                    m_frame_exporter->submit(packed_display);
+                }
+            }
+            response << ' ' << m_framebuffer->sequence / 2;
+        }
+        else if (command == "hash")
+        {
+            response << ' ' << std::hex << m_chip8->get_state_hash();
+        }
+        else if (command == "press")
+        {
+            m_chip8->press_key(read_hex("key") & 0xF);
+        }
+        else if (command == "release")
+        {
+            m_chip8->release_key(read_hex("key") & 0xF);
+        }
+        else if (command == "peek")
+        {
+            const auto address = read_hex("address");
+            unsigned long length{1};
+            if (std::string value; tokens >> value)
+            {
+                length = std::stoul(value, nullptr, 16);
+            }
+            check_range(address, length);
+
+            response << ' ' << std::hex;
+            for (unsigned long offset{0}; offset < length; offset++)
+            {
+                const auto byte = m_chip8->read_memory(address + offset);
+                response << (byte < 0x10 ? "0" : "") << static_cast<int>(byte);
+            }
+        }
+        else if (command == "poke")
+        {
+            const auto address = read_hex("address");
+            std::vector<std::uint8_t> bytes;
+            for (std::string value; tokens >> value;)
+            {
+                bytes.push_back(std::stoul(value, nullptr, 16) & 0xFF);
+            }
+            check_range(address, bytes.size());
+
+            for (std::size_t offset{0}; offset < bytes.size(); offset++)
+            {
+                m_chip8->write_memory(static_cast<std::uint16_t>(address + offset), bytes[offset]);
+            }
+        }
+        else if (command == "save_state")
+        {
+            std::ofstream state(read_path(), std::ios::binary);
+            m_chip8->save_state(state);
+        }
+        else if (command == "load_state")
+        {
+            std::ifstream state(read_path(), std::ios::binary);
+            if (!state.good())
+            {
+                throw std::runtime_error("Failed to open state");
+            }
+            m_chip8->load_state(state);
+            publish_frame();
+        }
+        else if (command == "quit")
+        {
+            m_client_connected = false;
+        }
+        else if (command == "shutdown")
+        {
+            m_run = false;
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown command " + command);
+        }
+
+        return response.str();
+    }
+    catch (const std::exception& e)
+    {
+        return std::string("ERR ") + e.what();
+    }
+}
+
+auto Control_Server::open_resources() -> void
+{
+    const int shared_memory_fd = shm_open(m_shared_memory_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (shared_memory_fd < 0)
+    {
+        throw std::runtime_error("Failed to create shared memory framebuffer!");
+    }
+
+    void* mapping{MAP_FAILED};
+    if (ftruncate(shared_memory_fd, sizeof(Shared_Framebuffer)) == 0)
+    {
+        mapping = mmap(nullptr, sizeof(Shared_Framebuffer), PROT_READ | PROT_WRITE,
+            MAP_SHARED, shared_memory_fd, 0);
+    }
+    close(shared_memory_fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        shm_unlink(m_shared_memory_name.c_str());
+        throw std::runtime_error("Failed to map shared memory framebuffer!");
+    }
+    m_framebuffer = new(mapping) Shared_Framebuffer{};
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (m_socket_path.native().size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("Socket path is too long!");
+    }
+    std::ranges::copy(m_socket_path.native(), address.sun_path);
+
+    m_socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_socket_fd < 0)
+    {
+        throw std::runtime_error("Failed to create control socket!");
+    }
+
+    if (!remove_socket_file(m_socket_path))
+    {
+        throw std::runtime_error("Socket path exists and is not a socket!");
+    }
+    if (bind(m_socket_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        close(m_socket_fd);
+        m_socket_fd = -1;
+        throw std::runtime_error("Failed to bind control socket!");
+    }
+
+    if (listen(m_socket_fd, 1) != 0)
+    {
+        throw std::runtime_error("Failed to listen on control socket!");
+    }
+}
+
+auto Control_Server::close_resources() -> void
+{
+    if (m_socket_fd >= 0)
+    {
+        close(m_socket_fd);
+        m_socket_fd = -1;
+        remove_socket_file(m_socket_path);
+    }
+
+    if (m_framebuffer != nullptr)
+    {
+        m_framebuffer->~Shared_Framebuffer();
+        munmap(m_framebuffer, sizeof(Shared_Framebuffer));
+        m_framebuffer = nullptr;
+        shm_unlink(m_shared_memory_name.c_str());
+    }
+}
+
+auto Control_Server::publish_frame() -> void
+{
+    auto& [sequence, width, height, pixels] = *m_framebuffer;
+
+    const auto begin = sequence.load(std::memory_order_relaxed);
+    sequence.store(begin + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const auto& display = m_chip8->get_display();
+    for (std::size_t index{0}; index < pixels.size(); index++)
+    {
+        pixels[index] = display[index / Chip8::DISPLAY_WIDTH] >> (Chip8::DISPLAY_WIDTH - 1 - index % Chip8::DISPLAY_WIDTH) & 1;
+    }
+
+    sequence.store(begin + 2, std::memory_order_release);
+}
@@ -0,0 +1,92 @@
+//
+// Unix domain socket control server with a shared memory framebuffer.
+//
+
+#ifndef CONTROL_SERVER_H
+#define CONTROL_SERVER_H
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "main.h"
+
+
+class Frame_Exporter;
+
+
+/*
+ * Layout of the shared memory segment. The sequence counter works as a sequence lock:
+ * it is odd while a frame is being written, so a reader copies the pixels and
+ * retries if the counter was odd or changed in the meantime. The number of the
+ * published frame is sequence / 2.
+ */
+struct Shared_Framebuffer
+{
+    std::atomic_uint64_t sequence{};
+    std::uint32_t width{Chip8::DISPLAY_WIDTH};
+    std::uint32_t height{Chip8::DISPLAY_HEIGHT};
+    std::array<std::uint8_t, Chip8::DISPLAY_WIDTH * Chip8::DISPLAY_HEIGHT> pixels{}; //One byte per pixel, 0 or 1
+};
+
+static_assert(std::atomic_uint64_t::is_always_lock_free);
+
+
+/*
+ * Line based text protocol, every command is answered with "OK [...]" or "ERR <reason>":
+ *
+ *   info                       -> OK <shared memory name> <frame counter>
+ *   load <path>                   Load a ROM into a fresh machine
+ *   seed <number> [stream]        Seed the random generator of the machine and of later loads
+ *   step <frames>              -> OK <frame counter>
+ *   hash                       -> OK <state hash in hex>
+ *   press <key> / release <key>   Key in hex, 0-F
+ *   peek <address> [length]    -> OK <hex bytes>
+ *   poke <address> <byte>...      Address and bytes in hex, within 0-FFF
+ *   save_state <path> / load_state <path>
+ *   quit                          Close the connection
+ *   shutdown                      Stop the server
+ */
+//Unlinks a socket left behind by an earlier run. Anything else at the path is kept, so a
+//mistyped path never deletes a file of the user; false is returned then
+auto remove_socket_file(const std::filesystem::path& socket_path) noexcept -> bool;
+
+
+class Control_Server
+{
+public:
+    Control_Server(std::filesystem::path socket_path, int instructions_per_frame, bool vip_timing, std::uint64_t seed);
+    ~Control_Server();
+
+    Control_Server(const Control_Server&) = delete;
+    auto operator=(const Control_Server&) -> Control_Server& = delete;
+
+    auto load_rom(const std::filesystem::path& rom_path) -> void;
+    //Every stepped frame is also passed to the exporter
+    auto attach_frame_exporter(Frame_Exporter* frame_exporter) -> void;
+    auto run() -> void;
+
+private:
+    auto handle_client(int client_fd) -> void;
+    [[nodiscard]] auto handle_command(const std::string& line) -> std::string;
+    auto publish_frame() -> void;
+    auto open_resources() -> void;
+    auto close_resources() -> void;
+
+    std::filesystem::path m_socket_path{};
+    std::string m_shared_memory_name{};
+    int m_instructions_per_frame{};
+    bool m_vip_timing{};
+    std::uint64_t m_seed{}; //Every loaded machine starts from this seed
+
+    int m_socket_fd{-1};
+    Shared_Framebuffer* m_framebuffer{nullptr};
+
+    std::unique_ptr<Chip8> m_chip8{};
+    Frame_Exporter* m_frame_exporter{nullptr};
+    bool m_run{true};
+    bool m_client_connected{false};
+};
+
+#endif //CONTROL_SERVER_H
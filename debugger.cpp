@@ -0,0 +1,396 @@
+//
+// Interactive terminal debugger.
+//
+
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "debugger.h"
+
+using namespace std::chrono_literals;
+
+
+auto Debugger::add_breakpoint(const std::uint16_t address) -> void
+{
+    m_breakpoints.set(address % MEMORY_SIZE);
+    update_active();
+}
+
+auto Debugger::remove_breakpoint(const std::uint16_t address) -> void
+{
+    m_breakpoints.reset(address % MEMORY_SIZE);
+    update_active();
+}
+
+auto Debugger::add_watchpoint(const std::uint16_t address) -> void
+{
+    m_watchpoints.set(address % MEMORY_SIZE);
+    update_active();
+}
+
+auto Debugger::remove_watchpoint(const std::uint16_t address) -> void
+{
+    m_watchpoints.reset(address % MEMORY_SIZE);
+    update_active();
+}
+
+auto Debugger::add_register_condition(const Register_Condition condition) -> void
+{
+    m_register_conditions.push_back(condition);
+    update_active();
+}
+
+auto Debugger::clear_register_conditions() -> void
+{
+    m_register_conditions.clear();
+    update_active();
+}
+
+auto Debugger::request_step(const int instructions) -> void
+{
+    m_steps_remaining = instructions;
+    update_active();
+}
+
+auto Debugger::set_prompt_hook(std::function<void(bool)> prompt_hook) -> void
+{
+    m_prompt_hook = std::move(prompt_hook);
+}
+
+auto Debugger::is_active() const -> bool
+{
+    return m_active;
+}
+
+auto Debugger::update_active() -> void
+{
+    m_active = m_steps_remaining > 0 or m_breakpoints.any()
+        or m_watchpoints.any() or !m_register_conditions.empty();
+}
+
+auto Debugger::before_instruction(Chip8& chip8) -> void
+{
+    //A store of an instruction that faulted is not reported by a later one
+    m_watchpoint_hit.reset();
+
+    const auto program_counter = chip8.get_program_counter();
+
+    if (m_steps_remaining > 0 and --m_steps_remaining == 0)
+    {
+        update_active();
+        prompt(chip8, "Step");
+        return;
+    }
+
+    if (m_breakpoints.test(program_counter % MEMORY_SIZE))
+    {
+        prompt(chip8, "Breakpoint");
+        return;
+    }
+
+    const auto& registers = chip8.get_registers();
+    for (auto& [reg, comparison, value, matched]: m_register_conditions)
+    {
+        const auto VX = registers.at(reg);
+
+        bool matches{false};
+        switch (comparison)
+        {
+        case Comparison::EQUAL: matches = VX == value; break;
+        case Comparison::NOT_EQUAL: matches = VX != value; break;
+        case Comparison::LESS: matches = VX < value; break;
+        case Comparison::GREATER: matches = VX > value; break;
+        }
+
+        const auto became_true = matches and !matched;
+        matched = matches;
+        if (became_true)
+        {
+            std::ostringstream reason;
+            reason << "Register condition on V" << std::hex << std::uppercase << static_cast<int>(reg);
+            prompt(chip8, reason.str());
+            return;
+        }
+    }
+}
+
+auto Debugger::after_instruction(Chip8& chip8) -> void
+{
+    if (!m_watchpoint_hit)
+    {
+        return;
+    }
+
+    const auto [address, old_value, new_value] = *m_watchpoint_hit;
+    m_watchpoint_hit.reset();
+
+    char reason[64];
+    std::snprintf(reason, sizeof(reason), "Watchpoint 0x%03X: 0x%02X -> 0x%02X", address, old_value, new_value);
+    prompt(chip8, reason);
+}
+
+auto Debugger::on_memory_write(const Chip8& chip8, const std::uint16_t address, const std::uint8_t value) -> void
+{
+    if (!m_watchpoint_hit and m_watchpoints.test(address % MEMORY_SIZE))
+    {
+        m_watchpoint_hit = Watchpoint_Hit{address, chip8.read_memory(address), value};
+    }
+}
+
+auto Debugger::prompt(Chip8& chip8, const std::string& reason) -> void
+{
+    //Stop the frontend from consuming the command line and switch the
+    //terminal back to blocking, line buffered input while the prompt is open
+    if (m_prompt_hook)
+    {
+        m_prompt_hook(true);
+    }
+    std::this_thread::sleep_for(10ms);
+
+    termios saved_term{};
+    tcgetattr(STDIN_FILENO, &saved_term);
+    const int saved_flags = fcntl(STDIN_FILENO, F_GETFL);
+
+    termios line_term = saved_term;
+    line_term.c_lflag |= ICANON | ECHO;
+    tcsetattr(STDIN_FILENO, TCSANOW, &line_term);
+    fcntl(STDIN_FILENO, F_SETFL, saved_flags & ~O_NONBLOCK);
+
+    std::printf("\n%s\n", reason.c_str());
+    print_state(chip8);
+
+    bool resume{false};
+    while (!resume)
+    {
+        std::printf("(chip8) ");
+        std::fflush(stdout);
+
+        std::string line;
+        char c{};
+        while (read(STDIN_FILENO, &c, 1) == 1 and c != '\n')
+        {
+            line += c;
+        }
+
+        if (line.empty() and c != '\n')
+        {
+            //Input closed
+            chip8.stop();
+            break;
+        }
+
+        resume = handle_command(chip8, line);
+    }
+
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved_term);
+    fcntl(STDIN_FILENO, F_SETFL, saved_flags);
+    if (m_prompt_hook)
+    {
+        m_prompt_hook(false);
+    }
+}
+
+auto Debugger::handle_command(Chip8& chip8, const std::string& line) -> bool
+{
+    std::istringstream tokens(line);
+    std::string command;
+    tokens >> command;
+
+    const auto read_hex = [&tokens]() -> std::uint16_t
+    {
+        std::string value;
+        tokens >> value;
+        return static_cast<std::uint16_t>(std::stoul(value, nullptr, 16));
+    };
+
+    try
+    {
+        if (command == "c" or command == "continue")
+        {
+            return true;
+        }
+
+        if (command == "s" or command == "step")
+        {
+            int instructions{1};
+            tokens >> instructions;
+            request_step(std::max(instructions, 1));
+            return true;
+        }
+
+        if (command == "b")
+        {
+            add_breakpoint(read_hex());
+        }
+        else if (command == "db")
+        {
+            remove_breakpoint(read_hex());
+        }
+        else if (command == "w")
+        {
+            add_watchpoint(read_hex());
+        }
+        else if (command == "dw")
+        {
+            remove_watchpoint(read_hex());
+        }
+        else if (command == "bc")
+        {
+            //e.g. "bc v3 == 1f"
+            std::string reg;
+            std::string comparison;
+            tokens >> reg >> comparison;
+            if (reg.size() != 2 or std::tolower(reg.front()) != 'v')
+            {
+                throw std::invalid_argument("Register must be V0 to VF");
+            }
+
+            Register_Condition condition{
+                .reg = static_cast<std::uint8_t>(std::stoi(reg.substr(1), nullptr, 16)),
+                .comparison = Comparison::EQUAL,
+                .value = 0,
+                .matched = false,
+            };
+            if (comparison == "==") condition.comparison = Comparison::EQUAL;
+            else if (comparison == "!=") condition.comparison = Comparison::NOT_EQUAL;
+            else if (comparison == "<") condition.comparison = Comparison::LESS;
+            else if (comparison == ">") condition.comparison = Comparison::GREATER;
+            else throw std::invalid_argument("Comparison must be ==, !=, < or >");
+
+            condition.value = static_cast<std::uint8_t>(read_hex());
+            add_register_condition(condition);
+        }
+        else if (command == "dc")
+        {
+            clear_register_conditions();
+        }
+        else if (command == "l")
+        {
+            for (int address{0}; address < MEMORY_SIZE; address++)
+            {
+                if (m_breakpoints.test(address))
+                {
+                    std::printf("breakpoint 0x%03X\n", address);
+                }
+            }
+            for (int address{0}; address < MEMORY_SIZE; address++)
+            {
+                if (m_watchpoints.test(address))
+                {
+                    std::printf("watchpoint 0x%03X\n", address);
+                }
+            }
+            for (const auto& [reg, comparison, value, matched]: m_register_conditions)
+            {
+                constexpr const char* COMPARISONS[]{"==", "!=", "<", ">"};
+                std::printf("condition V%X %s 0x%02X\n", reg, COMPARISONS[static_cast<int>(comparison)], value);
+            }
+        }
+        else if (command == "r")
+        {
+            print_state(chip8);
+        }
+        else if (command == "bt")
+        {
+            const auto call_stack = chip8.get_call_stack();
+            std::printf("#0 0x%03X\n", chip8.get_program_counter());
+            for (std::size_t depth{0}; depth < call_stack.size(); depth++)
+            {
+                //Return addresses, the call itself is the instruction before
+                const auto return_address = call_stack.at(call_stack.size() - 1 - depth);
+                std::printf("#%zu 0x%03X\n", depth + 1, return_address - 2);
+            }
+        }
+        else if (command == "m")
+        {
+            const auto address = read_hex();
+            int length{16};
+            if (std::string value; tokens >> value)
+            {
+                length = std::stoi(value, nullptr, 16);
+            }
+
+            for (int offset{0}; offset < length; offset++)
+            {
+                if (offset % 16 == 0)
+                {
+                    std::printf("%s0x%03X:", offset == 0 ? "" : "\n", address + offset);
+                }
+                std::printf(" %02X", chip8.read_memory(address + offset));
+            }
+            std::printf("\n");
+        }
+        else if (command == "q")
+        {
+            chip8.stop();
+            return true;
+        }
+        else if (!command.empty())
+        {
+            std::printf(
+                "c                continue\n"
+                "s [n]            step n instructions\n"
+                "b / db <addr>    set / delete breakpoint\n"
+                "w / dw <addr>    set / delete memory watchpoint\n"
+                "bc V<x> <op> <nn> break when the register comparison becomes true (==, !=, <, >)\n"
+                "dc               delete register conditions\n"
+                "l                list breakpoints, watchpoints and conditions\n"
+                "r                registers\n"
+                "bt               call stack\n"
+                "m <addr> [len]   dump memory\n"
+                "q                quit\n"
+                "Numbers are hex.\n");
+        }
+    }
+    catch (const std::exception&)
+    {
+        std::printf("Invalid arguments for %s\n", command.c_str());
+    }
+
+    return false;
+}
+
+auto Debugger::print_state(const Chip8& chip8) -> void
+{
+    const auto program_counter = chip8.get_program_counter();
+    //The next instruction fetch will fail, but the state can still be shown
+    if (std::size_t{program_counter} + 1 >= chip8.get_memory().size())
+    {
+        std::printf("PC 0x%03X  ----  past the end of memory\n", program_counter);
+    }
+    else
+    {
+        const std::uint16_t opcode = chip8.read_memory(program_counter) << 8 | chip8.read_memory(program_counter + 1);
+
+        const char* name = get_instruction_name(Chip8::decode(Chip8::get_nibbles(opcode)));
+
+        std::printf("PC 0x%03X  %04X  %s\n", program_counter, opcode, name);
+    }
+
+    const auto& registers = chip8.get_registers();
+    for (std::size_t reg{0}; reg < registers.size(); reg++)
+    {
+        std::printf("V%zX %02X%s", reg, registers.at(reg), reg % 8 == 7 ? "\n" : "  ");
+    }
+    std::printf("I  %03X  DT %02X  ST %02X  SP %zu\n", chip8.get_index_register(),
+        chip8.get_delay_timer(), chip8.get_sound_timer(), chip8.get_call_stack().size());
+}
+
+auto Debugger::get_instruction_name(const Chip8::Instruction instruction) -> const char*
+{
+    static constexpr std::array<const char*, 35> INSTRUCTION_NAMES
+    {
+        "00E0", "00EE", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+        "8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY7", "8XY6", "8XYE",
+        "9XY0", "ANNN", "BNNN", "CXNN", "DXYN", "EX9E", "EXA1",
+        "FX07", "FX15", "FX18", "FX1E", "FX0A", "FX29", "FX33", "FX55", "FX65",
+        "????",
+    };
+
+    return INSTRUCTION_NAMES.at(static_cast<std::size_t>(instruction));
+}
@@ -0,0 +1,78 @@
+//
+// Interactive terminal debugger.
+//
+
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "main.h"
+
+
+class Debugger
+{
+public:
+    struct Watchpoint_Hit
+    {
+        std::uint16_t address;
+        std::uint8_t old_value;
+        std::uint8_t new_value;
+    };
+
+    enum class Comparison: std::uint8_t
+    {
+        EQUAL, NOT_EQUAL, LESS, GREATER,
+    };
+
+    struct Register_Condition
+    {
+        std::uint8_t reg;
+        Comparison comparison;
+        std::uint8_t value;
+        bool matched{false}; //Breaks only when the condition becomes true
+    };
+
+    static constexpr int MEMORY_SIZE{4096};
+
+    auto add_breakpoint(std::uint16_t address) -> void;
+    auto remove_breakpoint(std::uint16_t address) -> void;
+    auto add_watchpoint(std::uint16_t address) -> void;
+    auto remove_watchpoint(std::uint16_t address) -> void;
+    auto add_register_condition(Register_Condition condition) -> void;
+    auto clear_register_conditions() -> void;
+    auto request_step(int instructions) -> void;
+    //Called with true before the prompt reads from the terminal and with false after it closed
+    auto set_prompt_hook(std::function<void(bool)> prompt_hook) -> void;
+
+    //True while anything has to be checked, otherwise the interpreter runs its regular loop
+    [[nodiscard]] auto is_active() const -> bool;
+
+    auto before_instruction(Chip8& chip8) -> void;
+    auto after_instruction(Chip8& chip8) -> void;
+    //Called by the interpreter before an instruction stores a byte, even one equal to the old value
+    auto on_memory_write(const Chip8& chip8, std::uint16_t address, std::uint8_t value) -> void;
+
+    [[nodiscard]] static auto get_instruction_name(Chip8::Instruction instruction) -> const char*;
+
+private:
+    auto update_active() -> void;
+    auto prompt(Chip8& chip8, const std::string& reason) -> void;
+    [[nodiscard]] auto handle_command(Chip8& chip8, const std::string& line) -> bool;
+    static auto print_state(const Chip8& chip8) -> void;
+
+    std::bitset<MEMORY_SIZE> m_breakpoints{};
+    std::bitset<MEMORY_SIZE> m_watchpoints{};
+    std::optional<Watchpoint_Hit> m_watchpoint_hit{}; //First watched store of the running instruction
+    std::vector<Register_Condition> m_register_conditions{};
+    int m_steps_remaining{0};
+    bool m_active{false};
+    std::function<void(bool)> m_prompt_hook{};
+};
+
+#endif //DEBUGGER_H
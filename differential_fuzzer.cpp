@@ -0,0 +1,764 @@
+//
+// Differential fuzzer comparing the execution engines.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "differential_fuzzer.h"
+#include "zobrist.h"
+
+
+namespace
+{
+    struct Opcode_Template
+    {
+        std::uint16_t base;
+        std::uint16_t random_bits;
+        bool address; //NNN is a jump or index target, mostly pointed into the ROM
+    };
+
+    constexpr std::array<Opcode_Template, 34> OPCODE_TEMPLATES
+    {{
+        {0x00E0, 0x0000, false}, {0x00EE, 0x0000, false},
+        {0x1000, 0x0FFF, true}, {0x2000, 0x0FFF, true},
+        {0x3000, 0x0FFF, false}, {0x4000, 0x0FFF, false}, {0x5000, 0x0FF0, false},
+        {0x6000, 0x0FFF, false}, {0x7000, 0x0FFF, false},
+        {0x8000, 0x0FF0, false}, {0x8001, 0x0FF0, false}, {0x8002, 0x0FF0, false},
+        {0x8003, 0x0FF0, false}, {0x8004, 0x0FF0, false}, {0x8005, 0x0FF0, false},
+        {0x8006, 0x0FF0, false}, {0x8007, 0x0FF0, false}, {0x800E, 0x0FF0, false},
+        {0x9000, 0x0FF0, false},
+        {0xA000, 0x0FFF, true}, {0xB000, 0x0FFF, true},
+        {0xC000, 0x0FFF, false}, {0xD000, 0x0FFF, false},
+        {0xE09E, 0x0F00, false}, {0xE0A1, 0x0F00, false},
+        {0xF007, 0x0F00, false}, {0xF00A, 0x0F00, false}, {0xF015, 0x0F00, false},
+        {0xF018, 0x0F00, false}, {0xF01E, 0x0F00, false}, {0xF029, 0x0F00, false},
+        {0xF033, 0x0F00, false}, {0xF055, 0x0F00, false}, {0xF065, 0x0F00, false},
+    }};
+
+    constexpr std::size_t MAX_ROM_SIZE{CORE_MEMORY_SIZE - CORE_START_ADDRESS};
+    constexpr std::size_t MIN_GENERATED_INSTRUCTIONS{8};
+    constexpr std::size_t MAX_GENERATED_INSTRUCTIONS{128};
+
+    auto generate_instruction(Pcg32& random, const std::size_t instruction_count) -> std::uint16_t
+    {
+        //A few arbitrary words cover the invalid encodings
+        if (random.next() % 256 == 0)
+        {
+            return static_cast<std::uint16_t>(random.next() >> 16);
+        }
+
+        auto opcode_template = &OPCODE_TEMPLATES[random.next() % OPCODE_TEMPLATES.size()];
+        //A return outside of a subroutine ends most runs right away, most of them are drawn again
+        if (opcode_template->base == 0x00EE and random.next() % 4 != 0)
+        {
+            opcode_template = &OPCODE_TEMPLATES[random.next() % OPCODE_TEMPLATES.size()];
+        }
+
+        const auto& [base, random_bits, address] = *opcode_template;
+        if (address and instruction_count > 0 and random.next() % 16 != 0)
+        {
+            return base | static_cast<std::uint16_t>(CORE_START_ADDRESS + 2 * (random.next() % instruction_count));
+        }
+
+        return base | static_cast<std::uint16_t>(random.next() & random_bits);
+    }
+
+    auto insert_instruction(std::vector<std::uint8_t>& rom, const std::size_t offset, const std::uint16_t opcode) -> void
+    {
+        const std::array<std::uint8_t, 2> bytes{static_cast<std::uint8_t>(opcode >> 8), static_cast<std::uint8_t>(opcode)};
+        rom.insert(rom.begin() + static_cast<std::ptrdiff_t>(offset), bytes.begin(), bytes.end());
+    }
+
+    auto generate_rom(Pcg32& random) -> std::vector<std::uint8_t>
+    {
+        const auto instruction_count = MIN_GENERATED_INSTRUCTIONS
+            + random.next() % (MAX_GENERATED_INSTRUCTIONS - MIN_GENERATED_INSTRUCTIONS + 1);
+
+        std::vector<std::uint8_t> rom;
+        rom.reserve(instruction_count * 2);
+        for (std::size_t i{0}; i + 1 < instruction_count; i++)
+        {
+            insert_instruction(rom, rom.size(), generate_instruction(random, instruction_count));
+        }
+        //Loop instead of running into the empty memory after the program
+        insert_instruction(rom, rom.size(), 0x1000 | CORE_START_ADDRESS);
+
+        return rom;
+    }
+
+    auto mutate_rom(Pcg32& random, std::vector<std::uint8_t> rom) -> std::vector<std::uint8_t>
+    {
+        const auto mutations = 1 + random.next() % 8;
+        for (std::uint32_t i{0}; i < mutations; i++)
+        {
+            const auto instruction_count = rom.size() / 2;
+            const auto offset = instruction_count > 0 ? 2 * (random.next() % instruction_count) : 0;
+
+            switch (random.next() % 5)
+            {
+            case 0:
+                if (!rom.empty())
+                {
+                    rom[random.next() % rom.size()] ^= 1 << random.next() % 8;
+                }
+                break;
+
+            case 1:
+                if (!rom.empty())
+                {
+                    rom[random.next() % rom.size()] = random.next_byte();
+                }
+                break;
+
+            case 2:
+                if (instruction_count > 0)
+                {
+                    const auto opcode = generate_instruction(random, instruction_count);
+                    rom[offset] = static_cast<std::uint8_t>(opcode >> 8);
+                    rom[offset + 1] = static_cast<std::uint8_t>(opcode);
+                }
+                break;
+
+            case 3:
+                if (rom.size() + 2 <= MAX_ROM_SIZE)
+                {
+                    insert_instruction(rom, offset, generate_instruction(random, instruction_count));
+                }
+                break;
+
+            default:
+                if (instruction_count > 0)
+                {
+                    rom.erase(rom.begin() + static_cast<std::ptrdiff_t>(offset),
+                        rom.begin() + static_cast<std::ptrdiff_t>(offset + 2));
+                }
+                break;
+            }
+        }
+
+        return rom;
+    }
+
+    auto describe_difference(const Fuzz_Snapshot& reference, const Fuzz_Snapshot& other) -> std::string
+    {
+        char difference[96];
+        const auto describe = [&difference](const char* name, const unsigned int expected, const unsigned int actual)
+        {
+            std::snprintf(difference, sizeof(difference), "%s 0x%X, reference 0x%X", name, actual, expected);
+            return std::string(difference);
+        };
+
+        if (reference.faulted != other.faulted)
+        {
+            return other.faulted ? "faulted, reference did not" : "did not fault, reference did";
+        }
+        for (std::size_t reg{0}; reg < reference.registers.size(); reg++)
+        {
+            if (reference.registers[reg] != other.registers[reg])
+            {
+                const char name[]{'V', "0123456789ABCDEF"[reg], '\0'};
+                return describe(name, reference.registers[reg], other.registers[reg]);
+            }
+        }
+        if (reference.index_register != other.index_register)
+        {
+            return describe("I", reference.index_register, other.index_register);
+        }
+        if (reference.program_counter != other.program_counter)
+        {
+            return describe("PC", reference.program_counter, other.program_counter);
+        }
+        if (reference.delay_timer != other.delay_timer)
+        {
+            return describe("delay timer", reference.delay_timer, other.delay_timer);
+        }
+        if (reference.sound_timer != other.sound_timer)
+        {
+            return describe("sound timer", reference.sound_timer, other.sound_timer);
+        }
+        if (reference.stack_depth != other.stack_depth or reference.stack != other.stack)
+        {
+            return describe("stack depth", reference.stack_depth, other.stack_depth);
+        }
+        for (std::size_t address{0}; address < reference.memory.size(); address++)
+        {
+            if (reference.memory[address] != other.memory[address])
+            {
+                std::snprintf(difference, sizeof(difference), "memory 0x%03zX 0x%02X, reference 0x%02X",
+                    address, other.memory[address], reference.memory[address]);
+                return difference;
+            }
+        }
+        for (std::size_t byte{0}; byte < reference.display.size(); byte++)
+        {
+            if (reference.display[byte] != other.display[byte])
+            {
+                std::snprintf(difference, sizeof(difference), "display row %zu",
+                    byte * 8 / CORE_DISPLAY_WIDTH);
+                return difference;
+            }
+        }
+
+        return "identical";
+    }
+
+    auto get_engine_index(const Fuzz_Engine engine) -> std::size_t
+    {
+        return static_cast<std::size_t>(engine);
+    }
+
+    auto get_reference_engine(const Fuzz_Engine engine) -> Fuzz_Engine
+    {
+        switch (engine)
+        {
+        case Fuzz_Engine::COSMAC_VIP:
+        case Fuzz_Engine::CHIP8_PACED:
+            return Fuzz_Engine::CHIP8_PACED;
+        default:
+            return Fuzz_Engine::CHIP8;
+        }
+    }
+
+    auto take_machine_snapshot(const Chip8& machine, Fuzz_Snapshot& snapshot) -> void
+    {
+        snapshot.registers = machine.get_registers();
+        snapshot.index_register = machine.get_index_register();
+        snapshot.program_counter = machine.get_program_counter();
+        snapshot.delay_timer = machine.get_delay_timer();
+        snapshot.sound_timer = machine.get_sound_timer();
+
+        const auto call_stack = machine.get_call_stack();
+        snapshot.stack_depth = static_cast<std::uint8_t>(call_stack.size());
+        snapshot.stack.fill(0);
+        std::copy_n(call_stack.begin(), std::min(call_stack.size(), snapshot.stack.size()), snapshot.stack.begin());
+
+        machine.get_memory().read(0, snapshot.memory);
+        machine.get_packed_display(snapshot.display);
+    }
+
+    auto describe_hashes(const char* name, const std::uint64_t hash, const char* expected_name,
+        const std::uint64_t expected) -> std::string
+    {
+        char difference[96];
+        std::snprintf(difference, sizeof(difference), "%s 0x%016llX, %s 0x%016llX", name,
+            static_cast<unsigned long long>(hash), expected_name, static_cast<unsigned long long>(expected));
+        return difference;
+    }
+}
+
+
+Fuzz_Runner::Fuzz_Runner()
+{
+    //A condition that never holds keeps the debugger hooks running without ever prompting
+    m_debugger.add_register_condition({.reg = 0, .comparison = Debugger::Comparison::LESS, .value = 0});
+    m_instrumented.attach_debugger(&m_debugger);
+}
+
+auto Fuzz_Runner::run(const Fuzz_Case& fuzz_case) -> std::optional<Fuzz_Divergence>
+{
+    load(fuzz_case);
+
+    const auto diverged = [&fuzz_case](const Fuzz_Engine engine, const int frame, std::string difference)
+    {
+        return Fuzz_Divergence{
+            .fuzz_case = fuzz_case,
+            .case_index = 0,
+            .engine = engine,
+            .frame = frame,
+            .difference = std::move(difference),
+        };
+    };
+
+    int frame{0};
+    for (; frame < static_cast<int>(fuzz_case.key_masks.size()); frame++)
+    {
+        for (const auto engine: FUZZ_ENGINES)
+        {
+            run_frame(engine, fuzz_case.key_masks[frame], fuzz_case.instructions_per_frame);
+            take_snapshot(engine, m_snapshots[get_engine_index(engine)]);
+        }
+
+        for (const auto engine: FUZZ_ENGINES)
+        {
+            const auto& reference = m_snapshots[get_engine_index(get_reference_engine(engine))];
+            const auto& snapshot = m_snapshots[get_engine_index(engine)];
+            if (snapshot != reference)
+            {
+                return diverged(engine, frame, describe_difference(reference, snapshot));
+            }
+        }
+
+        //All engines stopped at the same fault
+        if (std::ranges::all_of(m_faulted, std::identity{}))
+        {
+            break;
+        }
+    }
+
+    //A wrong key stays in the hash until the same wrong key is applied again, so checking
+    //once per case instead of after every frame finds nearly all errors at a fraction of the cost
+    const auto last_frame = std::min(frame, static_cast<int>(fuzz_case.key_masks.size()) - 1);
+    for (const auto engine: FUZZ_ENGINES)
+    {
+        if (auto difference = check_state_hash(engine))
+        {
+            return diverged(engine, last_frame, std::move(*difference));
+        }
+
+        const auto state_hash = get_state_hash(engine);
+        const auto reference_hash = get_state_hash(get_reference_engine(engine));
+        if (state_hash != reference_hash)
+        {
+            return diverged(engine, last_frame, describe_hashes("state hash", state_hash, "reference", reference_hash));
+        }
+    }
+
+    //Writes of the forked machine have to go to its own copies of the shared pages and display
+    Fuzz_Snapshot fork_parent;
+    take_machine_snapshot(m_fork_parent, fork_parent);
+    if (fork_parent != m_fork_parent_snapshot)
+    {
+        return diverged(Fuzz_Engine::CHIP8_FORKED, last_frame,
+            "fork parent changed, " + describe_difference(m_fork_parent_snapshot, fork_parent));
+    }
+    if (m_fork_parent.get_state_hash() != m_fork_parent_hash)
+    {
+        return diverged(Fuzz_Engine::CHIP8_FORKED, last_frame, describe_hashes("fork parent state hash",
+            m_fork_parent.get_state_hash(), "at the fork", m_fork_parent_hash));
+    }
+
+    return std::nullopt;
+}
+
+auto Fuzz_Runner::minimize(Fuzz_Divergence divergence) -> Fuzz_Divergence
+{
+    //Nothing after the first diverging frame matters
+    const auto trim_frames = [](Fuzz_Divergence& diverged)
+    {
+        diverged.fuzz_case.key_masks.resize(diverged.frame + 1);
+    };
+
+    //The candidate replaces the case if it still diverges, not necessarily the same way
+    const auto try_candidate = [&](const Fuzz_Case& candidate) -> bool
+    {
+        auto result = run(candidate);
+        if (!result)
+        {
+            return false;
+        }
+
+        result->case_index = divergence.case_index;
+        trim_frames(*result);
+        divergence = std::move(*result);
+        return true;
+    };
+
+    trim_frames(divergence);
+
+    auto candidate = divergence.fuzz_case;
+    std::ranges::fill(candidate.key_masks, 0);
+    try_candidate(candidate);
+
+    //One instruction per frame, with the keys of the frame the instruction ran in
+    if (divergence.fuzz_case.instructions_per_frame > 1)
+    {
+        candidate = divergence.fuzz_case;
+        candidate.instructions_per_frame = 1;
+        candidate.key_masks.clear();
+        for (const auto key_mask: divergence.fuzz_case.key_masks)
+        {
+            candidate.key_masks.insert(candidate.key_masks.end(), divergence.fuzz_case.instructions_per_frame, key_mask);
+        }
+        try_candidate(candidate);
+    }
+
+    //Remove chunks of instructions, halving the chunk size down to single instructions
+    for (auto chunk = std::bit_ceil(divergence.fuzz_case.rom.size()) / 2 & ~std::size_t{1}; chunk >= 2; chunk /= 2)
+    {
+        for (std::size_t offset{0}; offset < divergence.fuzz_case.rom.size();)
+        {
+            candidate = divergence.fuzz_case;
+            const auto end = std::min(offset + chunk, candidate.rom.size());
+            candidate.rom.erase(candidate.rom.begin() + static_cast<std::ptrdiff_t>(offset),
+                candidate.rom.begin() + static_cast<std::ptrdiff_t>(end));
+            if (!try_candidate(candidate))
+            {
+                offset += chunk;
+            }
+        }
+    }
+
+    return divergence;
+}
+
+auto Fuzz_Runner::load(const Fuzz_Case& fuzz_case) -> void
+{
+    for (Chip8* machine: {&m_chip8, &m_instrumented, &m_fork_parent, static_cast<Chip8*>(&m_cosmac_vip), &m_paced})
+    {
+        machine->reset();
+        machine->seed_random(fuzz_case.seed);
+        machine->load_rom(fuzz_case.rom);
+    }
+    m_forked = m_fork_parent.fork();
+    take_machine_snapshot(m_fork_parent, m_fork_parent_snapshot);
+    m_fork_parent_hash = m_fork_parent.get_state_hash();
+
+    //Also clears the cycles the last frame of the previous case ran over
+    m_cosmac_vip.set_timing_model({.enabled = true});
+
+    core_reset(m_core, fuzz_case.seed);
+    core_load_rom(m_core, fuzz_case.rom);
+
+    m_faulted.fill(false);
+}
+
+auto Fuzz_Runner::run_frame(const Fuzz_Engine engine, const std::uint16_t key_mask,
+    const int instructions_per_frame) -> void
+{
+    auto& faulted = m_faulted[get_engine_index(engine)];
+    if (faulted)
+    {
+        return;
+    }
+
+    if (engine == Fuzz_Engine::CORE)
+    {
+        m_core.key_mask = key_mask;
+        faulted = core_step_frame(m_core, instructions_per_frame) != Core_Status::OK;
+        return;
+    }
+
+    auto& machine = get_machine(engine);
+    machine.set_key_mask(key_mask);
+    const auto instruction_count = machine.get_instruction_count();
+    try
+    {
+        if (engine == Fuzz_Engine::CHIP8_PACED)
+        {
+            machine.run_frame(static_cast<int>(m_vip_frame_instructions));
+            //COSMAC_VIP does not count the instruction it faulted at, the reference has to fault at the next one
+            if (m_faulted[get_engine_index(Fuzz_Engine::COSMAC_VIP)])
+            {
+                machine.run_frame(1);
+            }
+        }
+        else
+        {
+            machine.run_frame(instructions_per_frame);
+        }
+        machine.update_timer();
+    }
+    catch (const std::exception&)
+    {
+        faulted = true;
+    }
+
+    if (engine == Fuzz_Engine::COSMAC_VIP)
+    {
+        m_vip_frame_instructions = machine.get_instruction_count() - instruction_count;
+    }
+}
+
+auto Fuzz_Runner::get_machine(const Fuzz_Engine engine) -> Chip8&
+{
+    switch (engine)
+    {
+    case Fuzz_Engine::CHIP8: return m_chip8;
+    case Fuzz_Engine::CHIP8_INSTRUMENTED: return m_instrumented;
+    case Fuzz_Engine::CHIP8_FORKED: return *m_forked;
+    case Fuzz_Engine::COSMAC_VIP: return m_cosmac_vip;
+    case Fuzz_Engine::CHIP8_PACED: return m_paced;
+    case Fuzz_Engine::CORE:
+    default: throw std::invalid_argument("Engine is not a Chip8!");
+    }
+}
+
+auto Fuzz_Runner::check_state_hash(const Fuzz_Engine engine) -> std::optional<std::string>
+{
+    if (engine == Fuzz_Engine::CORE)
+    {
+        return std::nullopt;
+    }
+
+    const auto& machine = get_machine(engine);
+    const auto state_hash = machine.get_state_hash();
+    const auto recomputed = machine.compute_state_hash();
+    if (state_hash == recomputed)
+    {
+        return std::nullopt;
+    }
+
+    return describe_hashes("state hash", state_hash, "recomputed", recomputed);
+}
+
+auto Fuzz_Runner::get_state_hash(const Fuzz_Engine engine) -> std::uint64_t
+{
+    if (engine == Fuzz_Engine::CORE)
+    {
+        //The core keeps no hash, computed the same way as Chip8::compute_state_hash()
+        const auto hash = zobrist_memory_hash(m_core.memory) ^ zobrist_display_hash(m_core.display)
+            ^ zobrist_stack_hash(std::span(m_core.stack).first(m_core.stack_pointer));
+        return zobrist_fold_cpu(hash, m_core, m_core.random);
+    }
+
+    return get_machine(engine).get_state_hash();
+}
+
+auto Fuzz_Runner::take_snapshot(const Fuzz_Engine engine, Fuzz_Snapshot& snapshot) -> void
+{
+    snapshot.faulted = m_faulted[get_engine_index(engine)];
+
+    if (engine == Fuzz_Engine::CORE)
+    {
+        snapshot.registers = m_core.registers;
+        snapshot.index_register = m_core.index_register;
+        snapshot.program_counter = m_core.program_counter;
+        snapshot.delay_timer = m_core.delay_timer;
+        snapshot.sound_timer = m_core.sound_timer;
+        snapshot.stack_depth = m_core.stack_pointer;
+        snapshot.stack.fill(0);
+        std::copy_n(m_core.stack.begin(), m_core.stack_pointer, snapshot.stack.begin());
+        snapshot.memory = m_core.memory;
+        core_get_packed_display(m_core, snapshot.display);
+        return;
+    }
+
+    take_machine_snapshot(get_machine(engine), snapshot);
+}
+
+
+auto generate_fuzz_case(Pcg32& random, const std::span<const std::vector<std::uint8_t>> corpus,
+    const int frames) -> Fuzz_Case
+{
+    Fuzz_Case fuzz_case;
+    fuzz_case.seed = std::uint64_t{random.next()} << 32 | random.next();
+    fuzz_case.instructions_per_frame = 1 + static_cast<int>(random.next() % 32);
+
+    if (!corpus.empty() and random.next() % 2 == 0)
+    {
+        fuzz_case.rom = mutate_rom(random, corpus[random.next() % corpus.size()]);
+        fuzz_case.rom.resize(std::min(fuzz_case.rom.size(), MAX_ROM_SIZE));
+    }
+    else
+    {
+        fuzz_case.rom = generate_rom(random);
+    }
+
+    //Keys stay held for a while, like a player would
+    std::uint16_t key_mask{0};
+    fuzz_case.key_masks.reserve(frames);
+    for (int frame{0}; frame < frames; frame++)
+    {
+        if (random.next() % 16 == 0)
+        {
+            switch (random.next() % 3)
+            {
+            case 0: key_mask = 0; break;
+            case 1: key_mask = static_cast<std::uint16_t>(1 << random.next() % 16); break;
+            default: key_mask = static_cast<std::uint16_t>(random.next()); break;
+            }
+        }
+        fuzz_case.key_masks.push_back(key_mask);
+    }
+
+    return fuzz_case;
+}
+
+auto run_differential_fuzzer(const Fuzz_Options& options) -> Fuzz_Result
+{
+    std::atomic_uint64_t next_case{0};
+    std::atomic_uint64_t cases_run{0};
+    std::atomic_uint64_t first_divergence{std::numeric_limits<std::uint64_t>::max()};
+    std::mutex divergence_mutex;
+    std::optional<Fuzz_Divergence> divergence;
+
+    const auto worker = [&]
+    {
+        Fuzz_Runner runner;
+        for (auto case_index = next_case++; case_index < options.cases; case_index = next_case++)
+        {
+            //Cases after a known divergence cannot be the lowest one
+            if (case_index > first_divergence)
+            {
+                return;
+            }
+
+            auto random = Pcg32::seeded(options.seed, case_index);
+            auto result = runner.run(generate_fuzz_case(random, options.corpus, options.frames));
+            cases_run++;
+            if (!result)
+            {
+                continue;
+            }
+
+            const std::lock_guard lock(divergence_mutex);
+            if (case_index < first_divergence)
+            {
+                result->case_index = case_index;
+                first_divergence = case_index;
+                divergence = std::move(result);
+            }
+        }
+    };
+
+    const auto worker_count = options.threads != 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    {
+        std::vector<std::jthread> workers;
+        for (unsigned int i{0}; i < worker_count; i++)
+        {
+            workers.emplace_back(worker);
+        }
+    }
+
+    Fuzz_Result result{.cases = cases_run};
+    if (divergence)
+    {
+        result.divergence = std::make_unique<Fuzz_Runner>()->minimize(*divergence);
+    }
+
+    return result;
+}
+
+auto write_fuzz_reproducer(const Fuzz_Divergence& divergence, const std::filesystem::path& directory)
+    -> std::filesystem::path
+{
+    const auto& [fuzz_case, case_index, engine, frame, difference] = divergence;
+
+    std::filesystem::create_directories(directory);
+    const auto name = "case_" + std::to_string(case_index);
+    const auto rom_path = directory / (name + ".ch8");
+    const auto reproducer_path = directory / (name + ".txt");
+
+    std::ofstream rom(rom_path, std::ios::binary | std::ios::out);
+    rom.write(reinterpret_cast<const char*>(fuzz_case.rom.data()), static_cast<std::streamsize>(fuzz_case.rom.size()));
+
+    std::ofstream reproducer(reproducer_path);
+    reproducer << "# Replay with: Chip8Fuzzer replay " << reproducer_path.filename().string() << "\n"
+        << "# " << get_fuzz_engine_name(engine) << " diverged in frame " << frame << ": " << difference << "\n"
+        << "rom " << rom_path.filename().string() << "\n"
+        << "seed 0x" << std::hex << fuzz_case.seed << std::dec << "\n"
+        << "instructions_per_frame " << fuzz_case.instructions_per_frame << "\n"
+        << "frames " << fuzz_case.key_masks.size() << "\n"
+        << "keys";
+
+    //Only the frames where the held keys change
+    std::uint16_t key_mask{0};
+    for (std::size_t i{0}; i < fuzz_case.key_masks.size(); i++)
+    {
+        if (fuzz_case.key_masks[i] != key_mask)
+        {
+            key_mask = fuzz_case.key_masks[i];
+            reproducer << " " << i << ":" << std::hex << key_mask << std::dec;
+        }
+    }
+    reproducer << "\n";
+
+    if (!rom.good() or !reproducer.good())
+    {
+        throw std::runtime_error("Failed to write reproducer!");
+    }
+
+    return reproducer_path;
+}
+
+auto read_fuzz_reproducer(const std::filesystem::path& reproducer_path) -> Fuzz_Case
+{
+    std::ifstream reproducer(reproducer_path);
+    if (!reproducer.good())
+    {
+        throw std::runtime_error("Failed to open reproducer!");
+    }
+
+    Fuzz_Case fuzz_case;
+    std::filesystem::path rom_path;
+    std::vector<std::pair<std::size_t, std::uint16_t>> key_changes;
+    std::string line;
+    while (std::getline(reproducer, line))
+    {
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream tokens(line);
+        std::string key;
+        if (!(tokens >> key))
+        {
+            continue;
+        }
+
+        std::string value;
+        if (key == "rom" and tokens >> value)
+        {
+            rom_path = reproducer_path.parent_path() / value;
+        }
+        else if (key == "seed" and tokens >> value)
+        {
+            fuzz_case.seed = std::stoull(value, nullptr, 0);
+        }
+        else if (key == "instructions_per_frame" and tokens >> value)
+        {
+            fuzz_case.instructions_per_frame = std::stoi(value);
+        }
+        else if (key == "frames" and tokens >> value)
+        {
+            fuzz_case.key_masks.resize(std::stoul(value));
+        }
+        else if (key == "keys")
+        {
+            while (tokens >> value)
+            {
+                const auto separator = value.find(':');
+                if (separator == std::string::npos)
+                {
+                    throw std::runtime_error("Invalid key change " + value + "!");
+                }
+                key_changes.emplace_back(std::stoul(value.substr(0, separator)),
+                    static_cast<std::uint16_t>(std::stoul(value.substr(separator + 1), nullptr, 16)));
+            }
+        }
+        else
+        {
+            throw std::runtime_error("Invalid reproducer line " + line + "!");
+        }
+    }
+
+    for (const auto& [frame, key_mask]: key_changes)
+    {
+        std::fill(fuzz_case.key_masks.begin() + static_cast<std::ptrdiff_t>(std::min(frame, fuzz_case.key_masks.size())),
+            fuzz_case.key_masks.end(), key_mask);
+    }
+
+    std::ifstream rom(rom_path, std::ios::binary | std::ios::in);
+    if (!rom.good())
+    {
+        throw std::runtime_error("Failed to open reproducer ROM!");
+    }
+    fuzz_case.rom.assign(std::istreambuf_iterator<char>(rom), std::istreambuf_iterator<char>());
+    if (fuzz_case.rom.size() > MAX_ROM_SIZE)
+    {
+        throw std::runtime_error("ROM size is to big for memory!");
+    }
+
+    return fuzz_case;
+}
+
+auto get_fuzz_engine_name(const Fuzz_Engine engine) -> const char*
+{
+    switch (engine)
+    {
+    case Fuzz_Engine::CHIP8: return "Chip8";
+    case Fuzz_Engine::CHIP8_INSTRUMENTED: return "Chip8 (instrumented)";
+    case Fuzz_Engine::CHIP8_FORKED: return "Chip8 (forked)";
+    case Fuzz_Engine::CORE: return "chip8_core";
+    case Fuzz_Engine::COSMAC_VIP: return "COSMAC_VIP";
+    case Fuzz_Engine::CHIP8_PACED: return "Chip8 (VIP paced)";
+    }
+
+    return "unknown";
+}
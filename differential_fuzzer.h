@@ -0,0 +1,146 @@
+//
+// Differential fuzzer comparing the execution engines.
+//
+
+#ifndef DIFFERENTIAL_FUZZER_H
+#define DIFFERENTIAL_FUZZER_H
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "main.h"
+#include "chip8_core.h"
+#include "debugger.h"
+
+
+enum class Fuzz_Engine: std::uint8_t
+{
+    CHIP8,              //Reference, a fixed number of instructions per frame
+    CHIP8_INSTRUMENTED, //Same instructions in the loop with debugger hooks
+    CHIP8_FORKED,       //Memory pages and display shared with the machine it was forked from
+    CORE,
+    COSMAC_VIP,         //Timing model on, a frame runs the instructions that fit its cycle budget
+    CHIP8_PACED,        //Reference for COSMAC_VIP, runs as many instructions each frame as it did
+};
+
+inline constexpr std::array FUZZ_ENGINES
+{
+    Fuzz_Engine::CHIP8, Fuzz_Engine::CHIP8_INSTRUMENTED, Fuzz_Engine::CHIP8_FORKED,
+    Fuzz_Engine::CORE, Fuzz_Engine::COSMAC_VIP, Fuzz_Engine::CHIP8_PACED,
+};
+
+struct Fuzz_Case
+{
+    std::vector<std::uint8_t> rom{};
+    std::vector<std::uint16_t> key_masks{}; //Keys held during each frame, one entry per frame
+    std::uint64_t seed{};
+    int instructions_per_frame{11};
+};
+
+//Everything the engines have to agree on after a frame
+struct Fuzz_Snapshot
+{
+    bool faulted{false};
+    std::array<std::uint8_t, 16> registers{};
+    std::uint16_t index_register{};
+    std::uint16_t program_counter{};
+    std::uint8_t delay_timer{};
+    std::uint8_t sound_timer{};
+    std::uint8_t stack_depth{};
+    std::array<std::uint16_t, CORE_STACK_SIZE> stack{};
+    std::array<std::uint8_t, CORE_MEMORY_SIZE> memory{};
+    std::array<std::uint8_t, CORE_PACKED_DISPLAY_BYTES> display{};
+
+    auto operator==(const Fuzz_Snapshot&) const -> bool = default;
+};
+
+struct Fuzz_Divergence
+{
+    Fuzz_Case fuzz_case{};
+    std::uint64_t case_index{};
+    Fuzz_Engine engine{};
+    int frame{};
+    std::string difference{}; //First field that differs from the reference
+};
+
+struct Fuzz_Options
+{
+    std::uint64_t seed{};
+    std::uint64_t cases{100000};
+    int frames{120};
+    unsigned int threads{0}; //0 uses every core
+    std::vector<std::vector<std::uint8_t>> corpus{}; //ROMs to mutate besides generated programs
+};
+
+struct Fuzz_Result
+{
+    std::uint64_t cases{};
+    std::optional<Fuzz_Divergence> divergence{}; //Lowest diverging case, minimized
+};
+
+
+/*
+ * Runs one case on every engine, frame by frame with the same seed and keys, and
+ * compares each engine against its reference after every frame. COSMAC_VIP runs a
+ * different number of instructions each frame, so it has a reference of its own that
+ * is stepped to the same instruction. At the end of the case, the incremental state
+ * hash of every Chip8 is checked against a recompute and against the hash of the
+ * reference, and the machine the forked one was copied from has to be unchanged.
+ * A fault ends the case, the engines then have to agree on the state at the faulting
+ * instruction. The machines are reused from case to case.
+ */
+class Fuzz_Runner
+{
+public:
+    Fuzz_Runner();
+
+    [[nodiscard]] auto run(const Fuzz_Case& fuzz_case) -> std::optional<Fuzz_Divergence>;
+    //Shrinks the ROM, frames and keys while the case keeps diverging
+    [[nodiscard]] auto minimize(Fuzz_Divergence divergence) -> Fuzz_Divergence;
+
+private:
+    auto load(const Fuzz_Case& fuzz_case) -> void;
+    auto run_frame(Fuzz_Engine engine, std::uint16_t key_mask, int instructions_per_frame) -> void;
+    [[nodiscard]] auto get_machine(Fuzz_Engine engine) -> Chip8&;
+    auto take_snapshot(Fuzz_Engine engine, Fuzz_Snapshot& snapshot) -> void;
+    [[nodiscard]] auto get_state_hash(Fuzz_Engine engine) -> std::uint64_t;
+    //Difference between the incrementally updated state hash of a machine and a full recompute
+    [[nodiscard]] auto check_state_hash(Fuzz_Engine engine) -> std::optional<std::string>;
+
+    Debugger m_debugger{};
+    Chip8 m_chip8{};
+    Chip8 m_instrumented{};
+    Chip8 m_fork_parent{};
+    std::unique_ptr<Chip8> m_forked{};
+    Core_State m_core{};
+    COSMAC_VIP m_cosmac_vip{};
+    Chip8 m_paced{};
+
+    std::array<bool, FUZZ_ENGINES.size()> m_faulted{};
+    std::array<Fuzz_Snapshot, FUZZ_ENGINES.size()> m_snapshots{};
+    Fuzz_Snapshot m_fork_parent_snapshot{}; //Taken when the case is loaded
+    std::uint64_t m_fork_parent_hash{};
+    std::uint64_t m_vip_frame_instructions{}; //Instructions COSMAC_VIP ran in the current frame
+};
+
+
+//Generated programs are mostly valid instructions jumping within the ROM
+[[nodiscard]] auto generate_fuzz_case(Pcg32& random, std::span<const std::vector<std::uint8_t>> corpus,
+    int frames) -> Fuzz_Case;
+//Case i of a run depends only on the seed and i, whatever the number of threads
+[[nodiscard]] auto run_differential_fuzzer(const Fuzz_Options& options) -> Fuzz_Result;
+
+//Writes the ROM and a text description next to it, returns the path of the description
+auto write_fuzz_reproducer(const Fuzz_Divergence& divergence, const std::filesystem::path& directory)
+    -> std::filesystem::path;
+[[nodiscard]] auto read_fuzz_reproducer(const std::filesystem::path& reproducer_path) -> Fuzz_Case;
+
+[[nodiscard]] auto get_fuzz_engine_name(Fuzz_Engine engine) -> const char*;
+
+#endif //DIFFERENTIAL_FUZZER_H
@@ -0,0 +1,132 @@
+//
+// Throughput of Vector_Env and a check that stepping it does not allocate.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "rl_env.h"
+
+
+namespace
+{
+    std::atomic_uint64_t allocation_count{0};
+
+    auto allocate(const std::size_t size, const std::size_t alignment) -> void*
+    {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+        //aligned_alloc needs a size that is a multiple of the alignment
+        const auto rounded_size = (std::max<std::size_t>(size, 1) + alignment - 1) / alignment * alignment;
+        void* memory = alignment > alignof(std::max_align_t)
+            ? std::aligned_alloc(alignment, rounded_size)
+            : std::malloc(rounded_size);
+        if (memory == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+
+        return memory;
+    }
+}
+
+
+//Every allocation of the process is counted, also those of the worker threads
+auto operator new(const std::size_t size) -> void*
+{
+    return allocate(size, alignof(std::max_align_t));
+}
+
+auto operator new(const std::size_t size, const std::align_val_t alignment) -> void*
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+auto operator delete(void* memory) noexcept -> void
+{
+    std::free(memory);
+}
+
+auto operator delete(void* memory, std::size_t) noexcept -> void
+{
+    std::free(memory);
+}
+
+auto operator delete(void* memory, std::align_val_t) noexcept -> void
+{
+    std::free(memory);
+}
+
+auto operator delete(void* memory, std::size_t, std::align_val_t) noexcept -> void
+{
+    std::free(memory);
+}
+
+
+auto main(int argc, char** argv) -> int
+{
+    try
+    {
+        if (argc < 2 or argc > 4)
+        {
+            throw std::runtime_error("Usage: ./Chip8EnvBenchmark /path/to/rom [environments] [steps]\n");
+        }
+
+        const int env_count = argc > 2 ? std::stoi(argv[2]) : 256;
+        const int steps = argc > 3 ? std::stoi(argv[3]) : 1000;
+        constexpr int WARMUP_STEPS{100};
+
+        //Short episodes, so resets are part of the measured steps
+        const Env_Options options{.frames_per_step = 4, .max_episode_frames = 200};
+        Vector_Env env(argv[1], env_count, Reward_Extractor::score_byte(0x300), options);
+
+        std::vector<std::uint8_t> observations(static_cast<std::size_t>(env_count) * Vector_Env::OBSERVATION_BYTES);
+        std::vector<std::uint8_t> actions(env_count);
+        std::vector<float> rewards(env_count);
+        std::vector<std::uint8_t> dones(env_count);
+
+        //Actions change every step, so keys are pressed and released as well
+        const auto step_all = [&](const int step)
+        {
+            for (int i{0}; i < env_count; i++)
+            {
+                actions[i] = static_cast<std::uint8_t>((step + i) % (Vector_Env::NO_ACTION + 1));
+            }
+            env.step(actions.data(), observations.data(), rewards.data(), dones.data());
+        };
+
+        env.reset(1, observations.data());
+        for (int step{0}; step < WARMUP_STEPS; step++)
+        {
+            step_all(step);
+        }
+
+        allocation_count = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int step{0}; step < steps; step++)
+        {
+            step_all(step);
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        const auto allocations = allocation_count.load();
+
+        const auto env_steps = static_cast<double>(env_count) * steps;
+        std::printf("%d environments, %d steps in %.2f s: %.0f environment steps/s, %.0f frames/s\n",
+            env_count, steps, elapsed.count(), env_steps / elapsed.count(),
+            env_steps * options.frames_per_step / elapsed.count());
+        std::printf("%llu allocations while stepping\n", static_cast<unsigned long long>(allocations));
+        return allocations == 0 ? 0 : 1;
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "%s", e.what());
+    }
+
+    return 2;
+}
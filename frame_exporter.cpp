@@ -0,0 +1,433 @@
+//
+// Streams emulated frames to a video or image file on a background thread.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <initializer_list>
+#include <string>
+
+#include "frame_exporter.h"
+
+
+namespace
+{
+    constexpr std::uint8_t Y4M_BLACK{16};
+    constexpr std::uint8_t Y4M_WHITE{235};
+    constexpr std::uint8_t Y4M_NEUTRAL_CHROMA{128};
+
+    //Many viewers play frames shorter than 2/100 s at 1/10 s, shorter frames are merged into the next one
+    constexpr std::uint16_t GIF_MIN_DELAY_CS{2};
+    constexpr std::uint16_t GIF_MAX_DELAY_CS{0xFFFF};
+    constexpr int GIF_MIN_CODE_SIZE{2};
+
+    /*
+     * Variable width LZW codes, least significant bit first, split into data
+     * sub-blocks of at most 255 bytes as GIF requires.
+     */
+    class Gif_Code_Writer
+    {
+    public:
+        explicit Gif_Code_Writer(std::vector<std::uint8_t>& out) : m_out(out) {}
+
+        auto write(const std::uint32_t code, const int code_size) -> void
+        {
+            m_bits |= code << m_bit_count;
+            m_bit_count += code_size;
+            while (m_bit_count >= 8)
+            {
+                write_byte(m_bits & 0xFF);
+                m_bits >>= 8;
+                m_bit_count -= 8;
+            }
+        }
+
+        auto finish() -> void
+        {
+            if (m_bit_count > 0)
+            {
+                write_byte(m_bits & 0xFF);
+            }
+            if (m_block_size > 0)
+            {
+                m_out[m_block_start] = m_block_size;
+            }
+            m_out.push_back(0); //Block terminator
+        }
+
+    private:
+        auto write_byte(const std::uint8_t byte) -> void
+        {
+            if (m_block_size == 0)
+            {
+                m_block_start = m_out.size();
+                m_out.push_back(0);
+            }
+            m_out.push_back(byte);
+
+            if (++m_block_size == 255)
+            {
+                m_out[m_block_start] = m_block_size;
+                m_block_size = 0;
+            }
+        }
+
+        std::vector<std::uint8_t>& m_out;
+        std::uint32_t m_bits{0};
+        int m_bit_count{0};
+        std::size_t m_block_start{0};
+        std::uint8_t m_block_size{0};
+    };
+
+    auto write_u16(std::vector<std::uint8_t>& out, const std::uint16_t value) -> void
+    {
+        out.push_back(value & 0xFF);
+        out.push_back(value >> 8);
+    }
+
+    //Byte by byte, GCC warns about a bogus overflow when a list is inserted right after clear()
+    auto write_bytes(std::vector<std::uint8_t>& out, const std::initializer_list<std::uint8_t> bytes) -> void
+    {
+        for (const auto byte: bytes)
+        {
+            out.push_back(byte);
+        }
+    }
+}
+
+
+Frame_Exporter::Frame_Exporter(std::filesystem::path export_path, const int scale)
+    : m_export_path(std::move(export_path)),
+      m_format(get_format(m_export_path)),
+      m_scale(scale),
+      m_width(Chip8::DISPLAY_WIDTH * scale),
+      m_height(Chip8::DISPLAY_HEIGHT * scale),
+      m_pixels(static_cast<std::size_t>(m_width) * m_height)
+{
+    if (scale < 1 or scale > 32)
+    {
+        throw std::invalid_argument("Export scale must be between 1 and 32!");
+    }
+
+    if (m_format == Export_Format::PPM)
+    {
+        if (!std::filesystem::is_directory(m_export_path.parent_path().empty() ? "." : m_export_path.parent_path()))
+        {
+            throw std::runtime_error("Export directory does not exist!");
+        }
+    }
+    else
+    {
+        m_file.open(m_export_path, std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!m_file.good())
+        {
+            throw std::runtime_error("Failed to open export file!");
+        }
+    }
+
+    if (m_format == Export_Format::Y4M)
+    {
+        m_file << "YUV4MPEG2 W" << m_width << " H" << m_height << " F" << FRAMES_PER_SECOND << ":1 Ip A1:1 C420jpeg\n";
+    }
+    else if (m_format == Export_Format::GIF)
+    {
+        write_gif_header();
+    }
+
+    m_writer = std::jthread([this] { writer_thread(); });
+}
+
+Frame_Exporter::~Frame_Exporter()
+{
+    m_stop.store(true, std::memory_order_release);
+    m_writer.join();
+}
+
+auto Frame_Exporter::get_format(const std::filesystem::path& export_path) -> Export_Format
+{
+    const auto extension = export_path.extension();
+    if (extension == ".y4m")
+    {
+        return Export_Format::Y4M;
+    }
+    if (extension == ".ppm")
+    {
+        return Export_Format::PPM;
+    }
+    if (extension == ".gif")
+    {
+        return Export_Format::GIF;
+    }
+
+    throw std::invalid_argument("Unsupported export format, use .y4m, .ppm or .gif!");
+}
+
+auto Frame_Exporter::submit(const std::span<const std::uint8_t, Chip8::PACKED_DISPLAY_BYTES> packed_display) -> void
+{
+    Packed_Frame frame;
+    std::ranges::copy(packed_display, frame.begin());
+
+    while (!m_queue.try_push(frame))
+    {
+        std::this_thread::yield();
+    }
+}
+
+auto Frame_Exporter::writer_thread() -> void
+{
+    Packed_Frame frame{};
+
+    //GIF only: the frame being shown and for how many frame periods so far
+    Packed_Frame pending{};
+    std::uint64_t pending_ticks{0};
+    std::uint64_t total_ticks{0};
+    std::uint64_t total_centiseconds{0};
+
+    const auto flush_pending = [&](const bool last)
+    {
+        const auto end_centiseconds = (total_ticks + pending_ticks) * 100 / FRAMES_PER_SECOND;
+        const auto delay = end_centiseconds - total_centiseconds;
+        if (pending_ticks == 0 or (delay < GIF_MIN_DELAY_CS and !last))
+        {
+            return;
+        }
+
+        write_gif_frame(pending, static_cast<std::uint16_t>(std::min<std::uint64_t>(delay, GIF_MAX_DELAY_CS)));
+        total_ticks += pending_ticks;
+        total_centiseconds = end_centiseconds;
+        pending_ticks = 0;
+    };
+
+    while (true)
+    {
+        if (!m_queue.try_pop(frame))
+        {
+            //Check the queue once more after the stop flag, the last frames may have been pushed just before it
+            if (m_stop.load(std::memory_order_acquire) and m_queue.empty())
+            {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        switch (m_format)
+        {
+        case Export_Format::Y4M:
+            scale_frame(frame);
+            write_y4m_frame();
+            break;
+
+        case Export_Format::PPM:
+            scale_frame(frame);
+            write_ppm_frame();
+            break;
+
+        case Export_Format::GIF:
+            //A frame too short to be shown is replaced by the new one, which takes over its time
+            if (pending_ticks > 0 and frame != pending)
+            {
+                flush_pending(false);
+            }
+            pending = frame;
+            pending_ticks++;
+            break;
+        }
+
+        m_frames_written++;
+    }
+
+    if (m_format == Export_Format::GIF)
+    {
+        flush_pending(true);
+        m_file.put(0x3B); //Trailer
+    }
+    m_file.flush();
+}
+
+auto Frame_Exporter::scale_frame(const Packed_Frame& frame) -> void
+{
+    for (int y{0}; y < Chip8::DISPLAY_HEIGHT; y++)
+    {
+        auto* row = m_pixels.data() + static_cast<std::size_t>(y) * m_scale * m_width;
+        for (int x{0}; x < Chip8::DISPLAY_WIDTH; x++)
+        {
+            const int index = y * Chip8::DISPLAY_WIDTH + x;
+            const std::uint8_t pixel = frame[index / 8] >> (7 - index % 8) & 1;
+            std::fill_n(row + x * m_scale, m_scale, pixel);
+        }
+
+        //Repeat the first scaled row for the rest of the block
+        for (int repeat{1}; repeat < m_scale; repeat++)
+        {
+            std::memcpy(row + repeat * m_width, row, m_width);
+        }
+    }
+}
+
+auto Frame_Exporter::write_y4m_frame() -> void
+{
+    const std::size_t luma_size = m_pixels.size();
+    const std::size_t chroma_size = luma_size / 4;
+
+    m_buffer.resize(luma_size + 2 * chroma_size);
+    std::ranges::transform(m_pixels, m_buffer.begin(), [](const std::uint8_t pixel)
+    {
+        return pixel ? Y4M_WHITE : Y4M_BLACK;
+    });
+    std::fill(m_buffer.begin() + luma_size, m_buffer.end(), Y4M_NEUTRAL_CHROMA);
+
+    m_file.write("FRAME\n", 6);
+    m_file.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size());
+}
+
+auto Frame_Exporter::write_ppm_frame() -> void
+{
+    std::array<char, 16> frame_number{};
+    std::snprintf(frame_number.data(), frame_number.size(), "_%06llu.ppm",
+        static_cast<unsigned long long>(m_frames_written));
+    const auto frame_path = m_export_path.parent_path() / (m_export_path.stem().string() + frame_number.data());
+
+    std::ofstream file(frame_path, std::ios::binary | std::ios::out | std::ios::trunc);
+
+    m_buffer.resize(m_pixels.size() * 3);
+    for (std::size_t i{0}; i < m_pixels.size(); i++)
+    {
+        const std::uint8_t value = m_pixels[i] ? 0xFF : 0x00;
+        m_buffer[i * 3] = m_buffer[i * 3 + 1] = m_buffer[i * 3 + 2] = value;
+    }
+
+    file << "P6\n" << m_width << ' ' << m_height << "\n255\n";
+    file.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size());
+}
+
+auto Frame_Exporter::write_gif_header() -> void
+{
+    m_buffer.clear();
+    for (const char c: std::string_view{"GIF89a"})
+    {
+        m_buffer.push_back(c);
+    }
+
+    //Logical screen with a global color table of two entries
+    write_u16(m_buffer, m_width);
+    write_u16(m_buffer, m_height);
+    write_bytes(m_buffer, {0xF0, 0x00, 0x00});
+    write_bytes(m_buffer, {0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF});
+
+    //Loop forever
+    write_bytes(m_buffer, {0x21, 0xFF, 0x0B});
+    for (const char c: std::string_view{"NETSCAPE2.0"})
+    {
+        m_buffer.push_back(c);
+    }
+    write_bytes(m_buffer, {0x03, 0x01, 0x00, 0x00, 0x00});
+
+    m_file.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size());
+}
+
+auto Frame_Exporter::write_gif_frame(const Packed_Frame& frame, const std::uint16_t delay) -> void
+{
+    //Only the rectangle around the pixels that changed since the last written frame is encoded
+    int left{Chip8::DISPLAY_WIDTH}, top{Chip8::DISPLAY_HEIGHT}, right{0}, bottom{0};
+    for (int y{0}; y < Chip8::DISPLAY_HEIGHT; y++)
+    {
+        for (int x{0}; x < Chip8::DISPLAY_WIDTH; x++)
+        {
+            const int index = y * Chip8::DISPLAY_WIDTH + x;
+            const int bit = 7 - index % 8;
+            if (m_gif_first_frame or ((frame[index / 8] ^ m_gif_previous[index / 8]) >> bit & 1))
+            {
+                left = std::min(left, x);
+                top = std::min(top, y);
+                right = std::max(right, x + 1);
+                bottom = std::max(bottom, y + 1);
+            }
+        }
+    }
+    if (left >= right)
+    {
+        //Nothing changed, a single pixel still carries the delay
+        left = top = 0;
+        right = bottom = 1;
+    }
+    m_gif_previous = frame;
+    m_gif_first_frame = false;
+    scale_frame(frame);
+
+    const int rect_left = left * m_scale;
+    const int rect_top = top * m_scale;
+    const int rect_width = (right - left) * m_scale;
+    const int rect_height = (bottom - top) * m_scale;
+
+    m_buffer.clear();
+
+    //Graphic control extension with the frame delay in 1/100 s, the frame stays in place for the next one
+    write_bytes(m_buffer, {0x21, 0xF9, 0x04, 0x04});
+    write_u16(m_buffer, delay);
+    write_bytes(m_buffer, {0x00, 0x00});
+
+    //Image descriptor without a local color table
+    m_buffer.push_back(0x2C);
+    write_u16(m_buffer, rect_left);
+    write_u16(m_buffer, rect_top);
+    write_u16(m_buffer, rect_width);
+    write_u16(m_buffer, rect_height);
+    m_buffer.push_back(0x00);
+
+    /*
+     * LZW with a dictionary stored as a tree: children[code][pixel] is the code of
+     * the string of code followed by pixel, 0 if it is not in the dictionary yet.
+     * Real codes are never 0, the first free code comes after clear and end codes.
+     */
+    constexpr std::uint32_t CLEAR_CODE{1 << GIF_MIN_CODE_SIZE};
+    constexpr std::uint32_t END_CODE{CLEAR_CODE + 1};
+    auto& children = m_gif_dictionary;
+
+    m_buffer.push_back(GIF_MIN_CODE_SIZE);
+    Gif_Code_Writer writer(m_buffer);
+
+    children.fill({});
+    int code_size{GIF_MIN_CODE_SIZE + 1};
+    std::uint32_t last_code{END_CODE};
+    writer.write(CLEAR_CODE, code_size);
+
+    const auto pixel_at = [&](const int i)
+    {
+        return m_pixels[static_cast<std::size_t>(rect_top + i / rect_width) * m_width + rect_left + i % rect_width];
+    };
+
+    std::uint32_t current{pixel_at(0)};
+    for (int i{1}; i < rect_width * rect_height; i++)
+    {
+        const auto pixel = pixel_at(i);
+        if (const auto child = children[current][pixel]; child != 0)
+        {
+            current = child;
+            continue;
+        }
+
+        writer.write(current, code_size);
+        children[current][pixel] = ++last_code;
+        if (last_code >= 1u << code_size)
+        {
+            code_size++;
+        }
+
+        if (last_code == Frame_Exporter::GIF_MAX_CODE)
+        {
+            writer.write(CLEAR_CODE, code_size);
+            children.fill({});
+            code_size = GIF_MIN_CODE_SIZE + 1;
+            last_code = END_CODE;
+        }
+        current = pixel;
+    }
+
+    writer.write(current, code_size);
+    writer.write(END_CODE, code_size);
+    writer.finish();
+
+    m_file.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size());
+}
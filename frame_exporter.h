@@ -0,0 +1,82 @@
+//
+// Streams emulated frames to a video or image file on a background thread.
+//
+
+#ifndef FRAME_EXPORTER_H
+#define FRAME_EXPORTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "main.h"
+#include "spsc_queue.h"
+
+
+enum class Export_Format: std::uint8_t
+{
+    Y4M, //Raw YUV4MPEG2 video at 60 fps, readable by ffmpeg and mpv
+    PPM, //One numbered binary PPM image per frame, <stem>_000000.ppm, ...
+    GIF, //Animated GIF, identical consecutive frames are merged into one
+};
+
+
+/*
+ * The interpreter thread only packs the display into a bounded lock-free queue.
+ * Scaling and encoding happen on the writer thread. Frames are never dropped: if
+ * the writer falls behind the interpreter yields until a slot is free.
+ */
+class Frame_Exporter
+{
+public:
+    static constexpr std::size_t QUEUE_FRAMES{1024};
+    static constexpr int DEFAULT_SCALE{8};
+    static constexpr int FRAMES_PER_SECOND{60};
+    static constexpr int GIF_MAX_CODE{4095};
+
+    //The format is chosen by the file extension
+    explicit Frame_Exporter(std::filesystem::path export_path, int scale = DEFAULT_SCALE);
+    ~Frame_Exporter();
+
+    Frame_Exporter(const Frame_Exporter&) = delete;
+    auto operator=(const Frame_Exporter&) -> Frame_Exporter& = delete;
+
+    //Only ever called from one thread
+    auto submit(std::span<const std::uint8_t, Chip8::PACKED_DISPLAY_BYTES> packed_display) -> void;
+
+    [[nodiscard]] static auto get_format(const std::filesystem::path& export_path) -> Export_Format;
+
+private:
+    using Packed_Frame = std::array<std::uint8_t, Chip8::PACKED_DISPLAY_BYTES>;
+
+    auto writer_thread() -> void;
+    auto scale_frame(const Packed_Frame& frame) -> void;
+
+    auto write_y4m_frame() -> void;
+    auto write_ppm_frame() -> void;
+    auto write_gif_frame(const Packed_Frame& frame, std::uint16_t delay) -> void;
+    auto write_gif_header() -> void;
+
+    std::filesystem::path m_export_path{};
+    Export_Format m_format{};
+    int m_scale{};
+    int m_width{};
+    int m_height{};
+
+    std::ofstream m_file{};
+    std::vector<std::uint8_t> m_pixels{}; //Scaled frame, one palette index per pixel
+    std::vector<std::uint8_t> m_buffer{};
+    std::array<std::array<std::uint16_t, 2>, GIF_MAX_CODE + 1> m_gif_dictionary{};
+    Packed_Frame m_gif_previous{};
+    bool m_gif_first_frame{true};
+    std::uint64_t m_frames_written{0};
+
+    Spsc_Queue<Packed_Frame, QUEUE_FRAMES> m_queue{};
+    std::atomic_bool m_stop{false};
+    std::jthread m_writer{};
+};
+
+#endif //FRAME_EXPORTER_H
@@ -0,0 +1,124 @@
+//
+// Command line front end of the differential fuzzer.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "differential_fuzzer.h"
+#include "rom_library.h"
+
+
+auto print_divergence(const Fuzz_Divergence& divergence) -> void
+{
+    const auto& [fuzz_case, case_index, engine, frame, difference] = divergence;
+    std::printf("%s diverged in frame %d: %s\n"
+                "ROM of %zu bytes, %d instructions per frame\n",
+        get_fuzz_engine_name(engine), frame, difference.c_str(),
+        fuzz_case.rom.size(), fuzz_case.instructions_per_frame);
+}
+
+auto run(const std::vector<std::string>& args) -> int
+{
+    Fuzz_Options options;
+    std::random_device random_device;
+    options.seed = std::uint64_t{random_device()} << 32 | random_device();
+
+    //ROM files, directories and tar archives
+    Rom_Library corpus;
+    const std::filesystem::path output_directory{args.at(1)};
+    for (std::size_t i{2}; i < args.size(); i++)
+    {
+        const auto& arg = args[i];
+        const auto has_value = i + 1 < args.size();
+        if (arg == "--seed" and has_value)
+        {
+            options.seed = std::stoull(args[++i], nullptr, 0);
+        }
+        else if (arg == "--cases" and has_value)
+        {
+            options.cases = std::stoull(args[++i]);
+        }
+        else if (arg == "--frames" and has_value)
+        {
+            options.frames = std::stoi(args[++i]);
+        }
+        else if (arg == "--threads" and has_value)
+        {
+            options.threads = std::stoul(args[++i]);
+        }
+        else
+        {
+            corpus.add(arg);
+        }
+    }
+
+    for (const auto& entry: corpus.get_entries())
+    {
+        options.corpus.emplace_back(entry.data.begin(), entry.data.end());
+    }
+
+    std::printf("Fuzzing %llu cases of %d frames with seed 0x%llx\n", static_cast<unsigned long long>(options.cases),
+        options.frames, static_cast<unsigned long long>(options.seed));
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto [cases, divergence] = run_differential_fuzzer(options);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::printf("%llu cases in %.1f s\n", static_cast<unsigned long long>(cases), elapsed.count());
+
+    if (!divergence)
+    {
+        std::printf("All engines agree\n");
+        return 0;
+    }
+
+    std::printf("Case %llu, minimized: ", static_cast<unsigned long long>(divergence->case_index));
+    print_divergence(*divergence);
+    std::printf("Reproducer written to %s\n", write_fuzz_reproducer(*divergence, output_directory).string().c_str());
+    return 1;
+}
+
+auto replay(const std::filesystem::path& reproducer_path) -> int
+{
+    const auto result = Fuzz_Runner().run(read_fuzz_reproducer(reproducer_path));
+    if (!result)
+    {
+        std::printf("All engines agree\n");
+        return 0;
+    }
+
+    print_divergence(*result);
+    return 1;
+}
+
+
+auto main(int argc, char** argv) -> int
+{
+    try
+    {
+        const std::vector<std::string> args(argv + 1, argv + argc);
+
+        if (args.size() >= 2 and args[0] == "run")
+        {
+            return run(args);
+        }
+
+        if (args.size() == 2 and args[0] == "replay")
+        {
+            return replay(args[1]);
+        }
+
+        throw std::runtime_error("Usage: ./Chip8Fuzzer run output_directory [--seed number] [--cases number]\n"
+                                 "                         [--frames number] [--threads number] [corpus rom, directory or tar...]\n"
+                                 "       ./Chip8Fuzzer replay reproducer\n");
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "%s", e.what());
+    }
+
+    return 2;
+}
@@ -5,33 +5,30 @@
 #ifndef MAIN_H
 #define MAIN_H
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
-#include <stack>
-#include <unordered_map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
 
+#include "chip8_core.h"
+#include "paged_memory.h"
+#include "pcg32.h"
 
+
+class Debugger;
+class Tracer;
+
+
+//The instructions themselves are core_execute in chip8_core, shared with core_step
 class Chip8
 {
 public:
-    static constexpr std::array<uint8_t, 80> FONTS
-    {
-        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-        0x20, 0x60, 0x20, 0x20, 0x70, // 1
-        0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-        0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-        0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-        0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-        0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-        0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-        0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-        0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-        0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-        0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-        0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-        0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-        0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-        0xF0, 0x80, 0xF0, 0x80, 0x80, // F
-    };
+    static constexpr std::array<std::uint8_t, 80> FONTS{CORE_FONTS};
 
     struct Nibbles
     {
@@ -41,161 +38,226 @@ public:
         std::uint8_t fourth_nibble;
     };
 
-    enum class Instruction: std::uint8_t
-    {
-        I_00E0 = 0, I_00EE = 1,
-        I_1NNN = 2,
-        I_2NNN = 3,
-        I_3XNN = 4,
-        I_4XNN = 5,
-        I_5XY0 = 6,
-        I_6XNN = 7,
-        I_7XNN = 8,
-        I_8XY0 = 9, I_8XY1 = 10, I_8XY2 = 11, I_8XY3 = 12, I_8XY4 = 13,
-        I_8XY5 = 14, I_8XY7 = 15, I_8XY6 = 16, I_8XYE = 17,
-        I_9XY0 = 18,
-        I_ANNN = 19,
-        I_BNNN = 20,
-        I_CXNN = 21,
-        I_DXYN = 22,
-        I_EX9E = 23, I_EXA1 = 24,
-        I_FX07 = 25, I_FX15 = 26, I_FX18 = 27, I_FX1E = 28, I_FX0A = 29,
-        I_FX29 = 30, I_FX33 = 31, I_FX55 = 32, I_FX65 = 33,
-        UNINITIALIZED = 34,
-    };
+    using Instruction = Core_Instruction;
 
-    enum class Keymap
+    struct Decoded_Instruction
     {
-        /*
-        * Keymap
-        * 1 2 3 4      1 2 3 C
-        * Q W E R  =>  4 5 6 D
-        * A S D F      7 8 9 E
-        * Z X C V      A 0 B F
-        */
-
-        K_1 = 0x1, K_2 = 0x2, K_3 = 0x3, K_4 = 0xC,
-        K_Q = 0x4, K_W = 0x5, K_E = 0x6, K_R = 0xD,
-        K_A = 0x7, K_S = 0x8, K_D = 0x9, K_F = 0xE,
-        K_Z = 0xA, K_X = 0x0, K_C = 0xB, K_V = 0xF,
+        Instruction instruction;
+        Nibbles nibbles;
     };
 
-    static inline const std::unordered_map<int, Keymap> CHAR_TO_KEYMAP
+    static constexpr std::uint16_t START_ADDRESS{0x200};
+    static constexpr int FONTSET_START_ADDRESS{0x50};
+    static constexpr std::size_t STACK_SIZE{CORE_STACK_SIZE};
+
+    static constexpr int DISPLAY_WIDTH{64};
+    static constexpr int DISPLAY_HEIGHT{32};
+
+    //One word per row, the most significant bit is the leftmost pixel
+    using Display = std::array<std::uint64_t, DISPLAY_HEIGHT>;
+    static constexpr int PACKED_DISPLAY_BYTES{DISPLAY_WIDTH * DISPLAY_HEIGHT / 8};
+
+    static constexpr std::size_t CACHE_LINE_SIZE{64};
+
+    struct alignas(CACHE_LINE_SIZE) Display_Buffer
     {
-        {49, Keymap::K_1}, {50, Keymap::K_2}, {51, Keymap::K_3}, {52, Keymap::K_4},
-        {113, Keymap::K_Q}, {119, Keymap::K_W}, {101, Keymap::K_E}, {114, Keymap::K_R},
-        {97, Keymap::K_A}, {115, Keymap::K_S}, {100, Keymap::K_D}, {102, Keymap::K_F},
-        {122, Keymap::K_Z}, {120, Keymap::K_X}, {99, Keymap::K_C}, {118, Keymap::K_V},
+        Display rows{};
     };
 
-    struct Keypress
+    //Everything an instruction touches besides memory and display, in one cache line
+    struct alignas(CACHE_LINE_SIZE) Cpu_State
     {
-        std::atomic_bool is_pressed{false};
-        std::chrono::time_point<std::chrono::system_clock> start_time{};
+        std::array<std::uint8_t, 16> registers{};
+        std::array<std::uint16_t, STACK_SIZE> stack{};
+        std::uint16_t index_register{};
+        std::uint16_t program_counter{START_ADDRESS};
+        std::uint8_t stack_pointer{};
+        std::uint8_t delay_timer{};
+        std::uint8_t sound_timer{};
+        std::uint16_t key_mask{}; //Bit n set while key n is held
     };
 
-    static constexpr std::uint16_t START_ADDRESS{0x200};
-    static constexpr int FONTSET_START_ADDRESS{0x50};
-
-    static constexpr int DISPLAY_WIDTH{64};
-    static constexpr int DISPLAY_HEIGHT{32};
+    static_assert(sizeof(Cpu_State) == CACHE_LINE_SIZE);
 
-    static constexpr int ESC_KEY{27};
-    static constexpr int TIME_TILL_KEY_RESETS_MS{150};
+    static constexpr std::array<char, 4> STATE_MAGIC{'C', '8', 'S', 'T'};
+    static constexpr std::uint8_t STATE_VERSION{2}; //Version 1 had no random generator state
 
 
     Chip8();
+    virtual ~Chip8() = default;
 
+    //Copy of the machine that shares memory pages and display with this one until either writes them
+    [[nodiscard]] virtual auto fork() const -> std::unique_ptr<Chip8>;
+    //Same as fork() into an existing instance, reusing it without allocating
+    auto copy_state_from(const Chip8& other) -> void;
+
+    //Keeps the random generator, it is only changed by seeding
+    auto reset() -> void;
+    //Same seed and stream give the same CXNN results, in Chip8 and in the core
+    auto seed_random(std::uint64_t seed, std::uint64_t stream = 0) -> void;
     auto read_rom(const std::filesystem::path& file_path) -> void;
-    auto main_loop(int cycle_time, int instructions_per_frame) -> void;
+    auto load_rom(std::span<const std::uint8_t> rom) -> void;
+    virtual auto run_frame(int instructions_per_frame) -> void;
     auto update_timer() -> void;
+    auto stop() -> void;
+    [[nodiscard]] auto is_running() const -> bool;
+
+    auto attach_debugger(Debugger* debugger) -> void;
+    auto attach_tracer(Tracer* tracer) -> void;
+    [[nodiscard]] auto is_instrumented() const -> bool;
 
     [[nodiscard]] auto fetch() -> std::uint16_t;
     [[nodiscard]] static auto decode(Nibbles nibbles) -> Instruction;
 
-    [[nodiscard]] static auto get_instruction_0XXX(Nibbles nibbles) -> Instruction;
-    [[nodiscard]] static auto get_instruction_8XXX(Nibbles nibbles) -> Instruction;
-    [[nodiscard]] static auto get_instruction_EXXX(Nibbles nibbles) -> Instruction;
-    [[nodiscard]] static auto get_instruction_FXXX(Nibbles nibbles) -> Instruction;
-
     auto execute(Instruction instruction, Nibbles nibbles) -> void;
 
-    auto OP_00E0() -> void;
-    auto OP_00EE() -> void;
-    auto OP_1NNN(Nibbles nibbles) -> void;
-    auto OP_2NNN(Nibbles nibbles) -> void;
-    auto OP_3XNN(Nibbles nibbles) -> void;
-    auto OP_4XNN(Nibbles nibbles) -> void;
-    auto OP_5XY0(Nibbles nibbles) -> void;
-    auto OP_9XY0(Nibbles nibbles) -> void;
-    auto OP_6XNN(Nibbles nibbles) -> void;
-    auto OP_7XNN(Nibbles nibbles) -> void;
-    auto OP_8XY0(Nibbles nibbles) -> void;
-    auto OP_8XY1(Nibbles nibbles) -> void;
-    auto OP_8XY2(Nibbles nibbles) -> void;
-    auto OP_8XY3(Nibbles nibbles) -> void;
-    auto OP_8XY4(Nibbles nibbles) -> void;
-    auto OP_8XY5(Nibbles nibbles) -> void;
-    auto OP_8XY7(Nibbles nibbles) -> void;
-    auto OP_8XY6(Nibbles nibbles) -> void;
-    auto OP_8XYE(Nibbles nibbles) -> void;
-    auto OP_ANNN(Nibbles nibbles) -> void;
-    auto OP_BNNN(Nibbles nibbles) -> void;
-    auto OP_CXNN(Nibbles nibbles) -> void;
-    auto OP_DXYN(Nibbles nibbles) -> void;
-    auto OP_EX9E(Nibbles nibbles) -> void;
-    auto OP_EXA1(Nibbles nibbles) -> void;
-    auto OP_FX07(Nibbles nibbles) -> void;
-    auto OP_FX15(Nibbles nibbles) -> void;
-    auto OP_FX18(Nibbles nibbles) -> void;
-    auto OP_FX1E(Nibbles nibbles) -> void;
-    auto OP_FX0A(Nibbles nibbles) -> void;
-    auto OP_FX29(Nibbles nibbles) -> void;
-    auto OP_FX33(Nibbles nibbles) -> void;
-    auto OP_FX55(Nibbles nibbles) -> void;
-    auto OP_FX65(Nibbles nibbles) -> void;
-
-    [[nodiscard]]static auto get_random_number() -> std::uint8_t;
-    auto draw_display() const -> void;
-    auto user_input_thread() -> void;
-
-    [[nodiscard]]auto get_ref_VX(Nibbles nibbles) -> std::uint8_t&;
-    [[nodiscard]]auto get_VY(Nibbles nibbles) const -> std::uint8_t;
-    auto set_VF(std::uint8_t val) -> void;
-
-    [[nodiscard]]static auto get_value_char_to_key_map(int key) -> std::uint8_t;
-    [[nodiscard]]static auto get_nibbles(std::uint16_t instruction) -> Nibbles;
+    auto save_state(std::ostream& out) const -> void;
+    auto load_state(std::istream& in) -> void;
+
+    [[nodiscard]] auto read_memory(std::uint16_t address) const -> std::uint8_t;
+    auto write_memory(std::uint16_t address, std::uint8_t value) -> void;
+    [[nodiscard]] auto get_display() const -> const Display&;
+    [[nodiscard]] auto get_memory() const -> const Paged_Memory&;
+    //One bit per pixel, row major, most significant bit first
+    auto get_packed_display(std::span<std::uint8_t, PACKED_DISPLAY_BYTES> packed_display) const -> void;
+    [[nodiscard]] auto get_registers() const -> const std::array<std::uint8_t, 16>&;
+    [[nodiscard]] auto get_index_register() const -> std::uint16_t;
+    [[nodiscard]] auto get_program_counter() const -> std::uint16_t;
+    [[nodiscard]] auto get_instruction_count() const -> std::uint64_t;
+    [[nodiscard]] auto get_delay_timer() const -> std::uint8_t;
+    [[nodiscard]] auto get_sound_timer() const -> std::uint8_t;
+    [[nodiscard]] auto get_call_stack() const -> std::vector<std::uint16_t>; //Bottom to top
+
+    //Change the keypad immediately, only from the thread running the interpreter
+    auto press_key(std::uint8_t key) -> void;
+    auto release_key(std::uint8_t key) -> void;
+    auto set_key_mask(std::uint16_t key_mask) -> void;
+    [[nodiscard]] auto get_frame_hash() const -> std::uint64_t;
+    //Zobrist-style hash of the whole machine including the held keys. Memory, display and call
+    //stack parts are kept up to date on every write, the rest is mixed in here
+    [[nodiscard]] auto get_state_hash() const -> std::uint64_t;
+    //Same value as get_state_hash(), computed from scratch to check the incremental parts
+    [[nodiscard]] auto compute_state_hash() const -> std::uint64_t;
 
-    [[nodiscard]]static auto get_number_NN(Nibbles nibbles) -> std::uint8_t;
-    [[nodiscard]]static auto get_number_NNN(Nibbles nibbles) -> std::uint16_t;
+    [[nodiscard]]static auto get_nibbles(std::uint16_t instruction) -> Nibbles;
 
 protected:
+    class Core_Access;
+
+    Chip8(const Chip8& other);
+
+    [[nodiscard]] auto get_writable_display() -> Display&;
+    //A private display about to be replaced takes the next copy instead of being freed
+    auto keep_spare_display() -> void;
+    //Memory writes of instructions, reported to the debugger
+    auto store_memory(std::size_t address, std::uint8_t value) -> void;
+
+    //Debugger and tracer hooks are compiled into a separate instantiation, so the loop
+    //without an active debugger or tracer stays the same as before
+    //before_execute(instruction, nibbles) runs after decoding, while the machine is still in the state before it
+    template<bool Instrumented, typename Before_Execute>
+    auto step(Before_Execute before_execute) -> Decoded_Instruction;
+    template<typename Before_Execute>
+    auto step_instrumented(Before_Execute before_execute) -> Decoded_Instruction;
+
+    static constexpr auto NO_HOOK = [](Instruction, Nibbles) {};
+    //Registers are compared against registers_before to find the changed one
+    auto record_trace(std::uint16_t program_counter, std::uint16_t opcode,
+        const std::array<std::uint8_t, 16>& registers_before, std::uint8_t flags) -> void;
+
+    //Cold and per frame state shares the first cache line with the vtable pointer
+    Debugger* m_debugger{nullptr};
+    Tracer* m_tracer{nullptr};
+    std::uint64_t m_instruction_count{};
+    std::uint64_t m_stack_hash{};
+    Pcg32 m_random{};
     std::atomic_bool m_run = true;
 
-    std::array<std::uint8_t, 16> m_registers{};
-    std::uint16_t m_index_register{};
-    std::uint16_t m_program_counter{};
+    Cpu_State m_cpu{};
 
-    std::stack<std::uint16_t> m_stack{};
-    //std::uint8_t m_stack_ptr{}; //unnecesary with this implementation
-
-    std::uint8_t m_delay_timer{};
-    std::uint8_t m_sound_timer{};
-
-    std::array<Keypress, 16> m_keymap{};
-
-    std::array<std::uint8_t, 4096> m_memory{};
-    std::array<bool, DISPLAY_WIDTH * DISPLAY_HEIGHT> m_display{};
+    alignas(CACHE_LINE_SIZE) Paged_Memory m_memory{};
+    std::shared_ptr<Display_Buffer> m_display{}; //Copied on write like the memory pages
+    std::shared_ptr<Display_Buffer> m_spare_display{}; //Only ever referenced from here
+    std::uint64_t m_display_hash{};
 };
 
+//Forked by the thousand, every byte added here is paid per instance
+static_assert(sizeof(Chip8) <= 7 * Chip8::CACHE_LINE_SIZE);
+
 class COSMAC_VIP: public Chip8
 {
+public:
+    //Machine cycles (8 clock cycles at 1.76 MHz) between two 60 Hz display interrupts
+    static constexpr int CYCLES_PER_FRAME{3668};
+    static constexpr int SKIP_TAKEN_CYCLES{2};
+
+    //00E0 and DXYN are charged what the clear and sprite routines of the VIP interpreter take,
+    //as counted by Cadmium's cycle-exact VIP CHIP-8 core (gulrak/cadmium, chip8strict): a clear
+    //is 3078 cycles, most of a 3668 cycle frame. A sprite row costs 46 cycles plus 20 for every
+    //bit the row is shifted right to reach VX. Drawing then waits for the display interrupt.
+    static constexpr int CLEAR_CYCLES{3078};
+    static constexpr int SPRITE_CYCLES{68};
+    static constexpr int SPRITE_ROW_CYCLES{46};
+    static constexpr int SPRITE_SHIFT_CYCLES{20};
+
+    struct Timing_Model
+    {
+        bool enabled{false};
+        int cycles_per_frame{CYCLES_PER_FRAME};
+        bool display_wait{true};
+    };
+
+    struct Instruction_Timing
+    {
+        std::uint16_t base;
+        std::uint16_t per_unit; //Per sprite row for DXYN, per register for FX55/FX65
+    };
 
+    //Cost in machine cycles of each instruction in the original VIP interpreter, indexed by
+    //Instruction. Besides 00E0 and DXYN, see above, the costs are approximate
+    static constexpr std::array<Instruction_Timing, 35> INSTRUCTION_TIMINGS
+    {{
+        {CLEAR_CYCLES, 0}, {23, 0}, // 00E0, 00EE
+        {23, 0},          // 1NNN
+        {23, 0},          // 2NNN
+        {10, 0},          // 3XNN
+        {10, 0},          // 4XNN
+        {14, 0},          // 5XY0
+        {6, 0},           // 6XNN
+        {10, 0},          // 7XNN
+        {44, 0}, {44, 0}, {44, 0}, {44, 0}, {44, 0}, // 8XY0, 8XY1, 8XY2, 8XY3, 8XY4
+        {44, 0}, {44, 0}, {44, 0}, {44, 0},          // 8XY5, 8XY7, 8XY6, 8XYE
+        {14, 0},          // 9XY0
+        {12, 0},          // ANNN
+        {23, 0},          // BNNN
+        {36, 0},          // CXNN
+        {SPRITE_CYCLES, SPRITE_ROW_CYCLES}, // DXYN, plus the shift
+        {14, 0}, {14, 0}, // EX9E, EXA1
+        {10, 0}, {10, 0}, {10, 0}, {19, 0}, {10, 0}, // FX07, FX15, FX18, FX1E, FX0A
+        {20, 0}, {204, 0}, {14, 14}, {14, 14},       // FX29, FX33, FX55, FX65
+        {0, 0},           // UNINITIALIZED
+    }};
+
+    [[nodiscard]] auto fork() const -> std::unique_ptr<Chip8> override;
+
+    auto set_timing_model(const Timing_Model& timing_model) -> void;
+    auto run_frame(int instructions_per_frame) -> void override;
+
+    [[nodiscard]] static auto get_instruction_cycles(Instruction instruction, Nibbles nibbles, std::uint8_t sprite_x = 0) -> int;
+    [[nodiscard]] static auto is_skip_instruction(Instruction instruction) -> bool;
+
+protected:
+    template<bool Instrumented>
+    auto run_cycle_budget() -> void;
+
+    Timing_Model m_timing_model{};
+    int m_cycle_overrun{}; //Cycles the last instruction of a frame ran into the next one
 };
 
 class CHIP_48: public Chip8
 {
-
+public:
+    [[nodiscard]] auto fork() const -> std::unique_ptr<Chip8> override;
 };
 
 
@@ -204,6 +266,18 @@ struct User_Input
     std::filesystem::path file_path{};
     int cycle_time{16};
     int instructions_per_frame{11};
+    bool vip_timing{false};
+    std::filesystem::path conformance_manifest{};
+    std::filesystem::path server_socket{};
+    bool debug{false};
+    std::filesystem::path trace_path{};
+    std::filesystem::path stats_path{};
+    std::filesystem::path host_socket{};
+    std::filesystem::path export_path{};
+    std::optional<std::uint64_t> seed{}; //Drawn from std::random_device if not given
+    std::filesystem::path rom_database{}; //Speeds and platforms looked up by ROM hash
+    std::filesystem::path library_path{};
+    bool speed_given{false}; //Cycle time or instructions per frame given, the database is not used for them
 };
 
 auto process_program_args(int argc, char** argv, User_Input& user_input) -> void;
@@ -0,0 +1,124 @@
+//
+// Copy-on-write paged memory.
+//
+
+#include <algorithm>
+
+#include "paged_memory.h"
+
+
+namespace
+{
+    //Every untouched page of every instance refers to this one
+    auto get_zero_page() -> const std::shared_ptr<Paged_Memory::Page>&
+    {
+        static const auto zero_page = std::make_shared<Paged_Memory::Page>();
+        return zero_page;
+    }
+}
+
+
+Paged_Memory::Paged_Memory()
+{
+    clear();
+}
+
+//The spares stay with the memory they came from
+Paged_Memory::Paged_Memory(const Paged_Memory& other)
+    : m_pages(other.m_pages),
+      m_hash(other.m_hash)
+{
+}
+
+auto Paged_Memory::operator=(const Paged_Memory& other) -> Paged_Memory&
+{
+    if (this != &other)
+    {
+        keep_spare_pages();
+        m_pages = other.m_pages;
+        m_hash = other.m_hash;
+    }
+
+    return *this;
+}
+
+auto Paged_Memory::clear() -> void
+{
+    keep_spare_pages();
+    m_pages.fill(get_zero_page());
+    m_hash = 0;
+}
+
+auto Paged_Memory::keep_spare_pages() -> void
+{
+    for (std::size_t page_index{0}; page_index < PAGE_COUNT; page_index++)
+    {
+        auto& page = m_pages[page_index];
+        if (page == nullptr or !is_exclusively_owned(page))
+        {
+            continue;
+        }
+
+        if (m_spare_pages == nullptr)
+        {
+            m_spare_pages = std::make_unique<Page_Table>();
+        }
+
+        auto& spare = (*m_spare_pages)[page_index];
+        if (spare == nullptr)
+        {
+            spare = std::move(page);
+        }
+    }
+}
+
+auto Paged_Memory::read(std::size_t address, std::span<std::uint8_t> out) const -> void
+{
+    if (address + out.size() > SIZE)
+    {
+        throw std::out_of_range("Memory address out of range!");
+    }
+
+    while (!out.empty())
+    {
+        const auto offset = address % PAGE_SIZE;
+        const auto length = std::min(PAGE_SIZE - offset, out.size());
+        const auto& page = *m_pages[address / PAGE_SIZE];
+
+        std::copy_n(page.begin() + offset, length, out.begin());
+        address += length;
+        out = out.subspan(length);
+    }
+}
+
+auto Paged_Memory::write(std::size_t address, std::span<const std::uint8_t> data) -> void
+{
+    if (address + data.size() > SIZE)
+    {
+        throw std::out_of_range("Memory address out of range!");
+    }
+
+    while (!data.empty())
+    {
+        const auto offset = address % PAGE_SIZE;
+        const auto length = std::min(PAGE_SIZE - offset, data.size());
+        auto& page = get_writable_page(address / PAGE_SIZE);
+
+        for (std::size_t i{0}; i < length; i++)
+        {
+            auto& byte = page[offset + i];
+            m_hash ^= zobrist_memory_key(address + i, byte) ^ zobrist_memory_key(address + i, data[i]);
+            byte = data[i];
+        }
+        address += length;
+        data = data.subspan(length);
+    }
+}
+
+auto Paged_Memory::get_private_page_count() const -> std::size_t
+{
+    return std::ranges::count_if(m_pages, [](const auto& page)
+    {
+        return page.use_count() == 1;
+    });
+}
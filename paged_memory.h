@@ -0,0 +1,134 @@
+//
+// Copy-on-write paged memory.
+//
+
+#ifndef PAGED_MEMORY_H
+#define PAGED_MEMORY_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+
+#include "zobrist.h"
+
+
+/*
+ * 4 KiB of memory split into 256 byte pages. Copies share all pages and a page is
+ * duplicated on the first write to it, so a copy costs 16 pointers and pages that
+ * are never written (ROM, fonts, unused memory) exist only once.
+ * Private pages replaced by clear() or an assignment are kept as spares and take the
+ * next copy of their slot, so a memory that is reset over and over stops allocating.
+ * The spare slots are allocated with the first spare, forks that are never reset do
+ * not carry them.
+ * A Zobrist hash of the content is updated on every write.
+ */
+class Paged_Memory
+{
+public:
+    static constexpr std::size_t SIZE{4096};
+    static constexpr std::size_t PAGE_SIZE{256};
+    static constexpr std::size_t PAGE_COUNT{SIZE / PAGE_SIZE};
+
+    //Cache line aligned, so a page spans 4 lines wherever it is allocated
+    struct alignas(64) Page: std::array<std::uint8_t, PAGE_SIZE>
+    {
+    };
+
+    Paged_Memory();
+    Paged_Memory(const Paged_Memory& other);
+    auto operator=(const Paged_Memory& other) -> Paged_Memory&;
+
+    [[nodiscard]] auto at(std::size_t address) const -> std::uint8_t;
+    auto set(std::size_t address, std::uint8_t value) -> void;
+
+    auto clear() -> void;
+    auto read(std::size_t address, std::span<std::uint8_t> out) const -> void;
+    auto write(std::size_t address, std::span<const std::uint8_t> data) -> void;
+
+    [[nodiscard]] static constexpr auto size() -> std::size_t { return SIZE; }
+    [[nodiscard]] auto get_private_page_count() const -> std::size_t;
+    [[nodiscard]] auto get_hash() const -> std::uint64_t;
+
+private:
+    auto get_writable_page(std::size_t page_index) -> Page&;
+    auto keep_spare_pages() -> void;
+
+    using Page_Table = std::array<std::shared_ptr<Page>, PAGE_COUNT>;
+
+    Page_Table m_pages{};
+    std::unique_ptr<Page_Table> m_spare_pages{}; //Pages only ever referenced from here
+    std::uint64_t m_hash{};
+};
+
+
+/*
+ * use_count() is a relaxed load. Another thread dropping its copy decrements the count with
+ * release ordering, the acquire fence makes its last reads of the object happen before our
+ * writes. A count that is stale and too high only costs a copy.
+ */
+template<typename T>
+[[nodiscard]] auto is_exclusively_owned(const std::shared_ptr<T>& pointer) -> bool
+{
+    if (pointer.use_count() != 1)
+    {
+        return false;
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+
+
+//Called for every fetched byte, kept inline
+
+inline auto Paged_Memory::at(const std::size_t address) const -> std::uint8_t
+{
+    if (address >= SIZE)
+    {
+        throw std::out_of_range("Memory address out of range!");
+    }
+
+    return (*m_pages[address / PAGE_SIZE])[address % PAGE_SIZE];
+}
+
+inline auto Paged_Memory::set(const std::size_t address, const std::uint8_t value) -> void
+{
+    if (address >= SIZE)
+    {
+        throw std::out_of_range("Memory address out of range!");
+    }
+
+    auto& byte = get_writable_page(address / PAGE_SIZE)[address % PAGE_SIZE];
+    m_hash ^= zobrist_memory_key(address, byte) ^ zobrist_memory_key(address, value);
+    byte = value;
+}
+
+inline auto Paged_Memory::get_hash() const -> std::uint64_t
+{
+    return m_hash;
+}
+
+inline auto Paged_Memory::get_writable_page(const std::size_t page_index) -> Page&
+{
+    auto& page = m_pages[page_index];
+    if (!is_exclusively_owned(page))
+    {
+        if (m_spare_pages != nullptr and (*m_spare_pages)[page_index] != nullptr)
+        {
+            auto& spare = (*m_spare_pages)[page_index];
+            *spare = *page;
+            page = std::move(spare);
+        }
+        else
+        {
+            page = std::make_shared<Page>(*page);
+        }
+    }
+
+    return *page;
+}
+
+#endif //PAGED_MEMORY_H
@@ -0,0 +1,60 @@
+//
+// Small seedable random number generator with independent streams.
+//
+
+#ifndef PCG32_H
+#define PCG32_H
+
+#include <cstdint>
+
+
+/*
+ * PCG-XSH-RR: a 64 bit linear congruential state with a permuted 32 bit output.
+ * The increment selects one of 2^63 streams, generators seeded alike but on
+ * different streams give unrelated sequences, so a batch derives one stream per
+ * instance from a single master seed. Both fields are plain state and can be
+ * copied and saved as they are.
+ */
+struct Pcg32
+{
+    static constexpr std::uint64_t MULTIPLIER{6364136223846793005};
+    static constexpr std::uint64_t DEFAULT_SEED{0x853C49E6748FEA9B};
+
+    std::uint64_t state{DEFAULT_SEED};
+    std::uint64_t increment{0xDA3E39CB94B95BDB};
+
+    [[nodiscard]] static constexpr auto seeded(std::uint64_t seed, std::uint64_t stream = 0) -> Pcg32;
+
+    constexpr auto next() -> std::uint32_t;
+    //Highest output bits, the best ones of a PCG
+    constexpr auto next_byte() -> std::uint8_t;
+
+    friend constexpr auto operator==(const Pcg32&, const Pcg32&) -> bool = default;
+};
+
+
+constexpr auto Pcg32::seeded(const std::uint64_t seed, const std::uint64_t stream) -> Pcg32
+{
+    Pcg32 generator{.state = 0, .increment = stream << 1 | 1};
+    generator.next();
+    generator.state += seed;
+    generator.next();
+    return generator;
+}
+
+constexpr auto Pcg32::next() -> std::uint32_t
+{
+    const auto old_state = state;
+    state = old_state * MULTIPLIER + increment;
+
+    const auto xorshifted = static_cast<std::uint32_t>(((old_state >> 18) ^ old_state) >> 27);
+    const auto rotation = static_cast<std::uint32_t>(old_state >> 59);
+    return xorshifted >> rotation | xorshifted << (-rotation & 31);
+}
+
+constexpr auto Pcg32::next_byte() -> std::uint8_t
+{
+    return next() >> 24;
+}
+
+#endif //PCG32_H
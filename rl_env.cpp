@@ -0,0 +1,287 @@
+//
+// Batched environment API for training agents on CHIP-8 games.
+//
+
+#include <algorithm>
+
+#include "rl_env.h"
+
+
+auto Reward_Extractor::score_byte(const std::uint16_t address) -> Reward_Extractor
+{
+    return {
+        .read_score = [address](const Chip8& chip8)
+        {
+            return static_cast<int>(chip8.read_memory(address));
+        },
+    };
+}
+
+auto Reward_Extractor::score_bcd(const std::uint16_t address, const int digits) -> Reward_Extractor
+{
+    return {
+        .read_score = [address, digits](const Chip8& chip8)
+        {
+            int score{0};
+            for (int digit{0}; digit < digits; digit++)
+            {
+                score = score * 10 + chip8.read_memory(address + digit) % 10;
+            }
+            return score;
+        },
+    };
+}
+
+auto Reward_Extractor::done_when_equal(const std::uint16_t address, const std::uint8_t value) -> Reward_Extractor&
+{
+    is_done = [address, value](const Chip8& chip8)
+    {
+        return chip8.read_memory(address) == value;
+    };
+    return *this;
+}
+
+
+Vector_Env::Vector_Env(const std::filesystem::path& rom_path, const int env_count,
+    Reward_Extractor reward_extractor, const Env_Options options)
+    : m_reward_extractor(std::move(reward_extractor)),
+      m_options(options),
+      m_thread_count(std::clamp(options.thread_count != 0 ? options.thread_count : std::thread::hardware_concurrency(),
+          1u, static_cast<unsigned int>(std::max(env_count, 1)))),
+      m_barrier(m_thread_count),
+      m_errors(m_thread_count)
+{
+    if (env_count <= 0)
+    {
+        throw std::invalid_argument("Environment count must be a positive number!");
+    }
+
+    if (!m_reward_extractor.read_score)
+    {
+        throw std::invalid_argument("Reward extractor has no score function!");
+    }
+
+    m_initial_state.read_rom(rom_path);
+
+    m_envs.reserve(env_count);
+    for (int i{0}; i < env_count; i++)
+    {
+        m_envs.push_back(std::make_unique<Env>());
+        m_envs.back()->stream = i;
+    }
+
+    //The calling thread works on the first range itself
+    for (unsigned int worker_index{1}; worker_index < m_thread_count; worker_index++)
+    {
+        m_workers.emplace_back(&Vector_Env::worker, this, worker_index);
+    }
+}
+
+Vector_Env::~Vector_Env()
+{
+    m_shutdown = true;
+    m_barrier.arrive_and_wait();
+}
+
+auto Vector_Env::size() const -> int
+{
+    return static_cast<int>(m_envs.size());
+}
+
+auto Vector_Env::reset(const std::uint64_t seed, std::uint8_t* observations) -> void
+{
+    //One master seed, a separate stream for every environment
+    for (auto& env: m_envs)
+    {
+        env->random = Pcg32::seeded(seed, env->stream);
+    }
+
+    m_resetting = true;
+    run_batch({
+        .actions = nullptr,
+        .observations = observations,
+        .rewards = nullptr,
+        .dones = nullptr,
+    });
+    m_resetting = false;
+}
+
+auto Vector_Env::step(const std::uint8_t* actions, std::uint8_t* observations,
+    float* rewards, std::uint8_t* dones) -> void
+{
+    run_batch({
+        .actions = actions,
+        .observations = observations,
+        .rewards = rewards,
+        .dones = dones,
+    });
+}
+
+auto Vector_Env::get_state_hashes(std::uint64_t* hashes) const -> void
+{
+    for (const auto& env: m_envs)
+    {
+        *hashes++ = env->chip8.get_state_hash();
+    }
+}
+
+auto Vector_Env::run_batch(const Step_Buffers& buffers) -> void
+{
+    m_buffers = buffers;
+
+    m_barrier.arrive_and_wait();
+    process_range(0);
+    m_barrier.arrive_and_wait();
+
+    //An exception of any worker is thrown here, on the calling thread
+    const auto error = std::ranges::find_if(m_errors, [](const std::exception_ptr& worker_error)
+    {
+        return worker_error != nullptr;
+    });
+    if (error != m_errors.end())
+    {
+        const auto first_error = *error;
+        std::ranges::fill(m_errors, nullptr);
+        std::rethrow_exception(first_error);
+    }
+}
+
+auto Vector_Env::worker(const unsigned int worker_index) -> void
+{
+    while (true)
+    {
+        m_barrier.arrive_and_wait();
+        if (m_shutdown)
+        {
+            return;
+        }
+
+        process_range(worker_index);
+        m_barrier.arrive_and_wait();
+    }
+}
+
+auto Vector_Env::process_range(const unsigned int worker_index) -> void
+{
+    const auto env_count = m_envs.size();
+    const auto begin = env_count * worker_index / m_thread_count;
+    const auto end = env_count * (worker_index + 1) / m_thread_count;
+
+    //Escaping the thread function would terminate, the range stops and the error is kept for run_batch
+    try
+    {
+        const auto [actions, observations, rewards, dones] = m_buffers;
+        for (auto i = begin; i < end; i++)
+        {
+            auto& env = *m_envs[i];
+            if (m_resetting)
+            {
+                reset_env(env);
+            }
+            else
+            {
+                step_env(env, actions[i], rewards[i], dones[i]);
+            }
+
+            env.chip8.get_packed_display(std::span<std::uint8_t, OBSERVATION_BYTES>(
+                observations + i * OBSERVATION_BYTES, OBSERVATION_BYTES));
+        }
+    }
+    catch (...)
+    {
+        m_errors[worker_index] = std::current_exception();
+    }
+}
+
+auto Vector_Env::reset_env(Env& env) -> void
+{
+    //All environments share the ROM pages of the initial state
+    env.chip8.copy_state_from(m_initial_state);
+    env.held_key = NO_ACTION;
+    env.episode_frames = 0;
+
+    const std::uint64_t episode_seed = std::uint64_t{env.random.next()} << 32 | env.random.next();
+    env.chip8.seed_random(episode_seed, env.stream);
+
+    const auto noop_frames = m_options.max_noop_frames > 0
+        ? static_cast<int>(env.random.next() % (m_options.max_noop_frames + 1))
+        : 0;
+
+    try
+    {
+        for (int frame{0}; frame < noop_frames; frame++)
+        {
+            env.chip8.run_frame(m_options.instructions_per_frame);
+            env.chip8.update_timer();
+        }
+    }
+    catch (const std::exception&)
+    {
+        //Broken ROM, the first step will report the episode as done
+    }
+
+    env.score = m_reward_extractor.read_score(env.chip8);
+}
+
+auto Vector_Env::step_env(Env& env, const std::uint8_t action, float& reward, std::uint8_t& done) -> void
+{
+    if (action != env.held_key)
+    {
+        if (env.held_key != NO_ACTION)
+        {
+            env.chip8.release_key(env.held_key);
+        }
+
+        env.held_key = action < NO_ACTION ? action : NO_ACTION;
+        if (env.held_key != NO_ACTION)
+        {
+            env.chip8.press_key(env.held_key);
+        }
+    }
+
+    bool crashed{false};
+    try
+    {
+        for (int frame{0}; frame < m_options.frames_per_step; frame++)
+        {
+            env.chip8.run_frame(m_options.instructions_per_frame);
+            env.chip8.update_timer();
+        }
+    }
+    catch (const std::exception&)
+    {
+        crashed = true;
+    }
+    env.episode_frames += m_options.frames_per_step;
+
+    const auto score = m_reward_extractor.read_score(env.chip8);
+    reward = static_cast<float>(score - env.score);
+    env.score = score;
+
+    const bool truncated = m_options.max_episode_frames > 0 and env.episode_frames >= m_options.max_episode_frames;
+    done = crashed or truncated or is_done(env);
+    if (done)
+    {
+        reset_env(env);
+    }
+}
+
+auto Vector_Env::is_done(const Env& env) const -> bool
+{
+    if (m_reward_extractor.is_done)
+    {
+        return m_reward_extractor.is_done(env.chip8);
+    }
+
+    //Halted on a jump to itself, or ran off the end of memory and would fault on the next fetch
+    const auto program_counter = env.chip8.get_program_counter();
+    if (std::size_t{program_counter} + 1 >= Paged_Memory::size())
+    {
+        return true;
+    }
+
+    const std::uint16_t opcode = env.chip8.read_memory(program_counter) << 8
+        | env.chip8.read_memory(program_counter + 1);
+
+    return opcode == (0x1000 | program_counter);
+}
@@ -0,0 +1,121 @@
+//
+// Batched environment API for training agents on CHIP-8 games.
+//
+
+#ifndef RL_ENV_H
+#define RL_ENV_H
+
+#include <atomic>
+#include <barrier>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "main.h"
+
+
+/*
+ * Reads the game score from memory. The reward of a step is the difference of the
+ * score before and after the step. is_done is optional, without it an episode ends
+ * when the program halts by jumping to itself or its program counter leaves memory.
+ */
+struct Reward_Extractor
+{
+    std::function<int(const Chip8& chip8)> read_score{};
+    std::function<bool(const Chip8& chip8)> is_done{};
+
+    //Score stored as a single byte
+    [[nodiscard]] static auto score_byte(std::uint16_t address) -> Reward_Extractor;
+    //Score stored as BCD digits, one digit per byte, most significant first (as written by FX33)
+    [[nodiscard]] static auto score_bcd(std::uint16_t address, int digits) -> Reward_Extractor;
+    //Episode ends when the byte at address equals value
+    auto done_when_equal(std::uint16_t address, std::uint8_t value) -> Reward_Extractor&;
+};
+
+
+struct Env_Options
+{
+    int instructions_per_frame{11};
+    int frames_per_step{4};
+    int max_noop_frames{30};      //A random number of frames in [0, max] is skipped on reset
+    int max_episode_frames{0};    //Episodes are truncated after this many frames, 0 for no limit
+    unsigned int thread_count{0}; //0 for one thread per core
+};
+
+
+/*
+ * Runs a batch of Chip8 instances with the same ROM. Observations are the packed display,
+ * one bit per pixel, row major, most significant bit first. All buffers are provided by the
+ * caller and laid out contiguously per environment. Finished environments are reset
+ * automatically, their observation is already the first one of the next episode.
+ */
+class Vector_Env
+{
+public:
+    static constexpr int OBSERVATION_BYTES{Chip8::PACKED_DISPLAY_BYTES};
+    static constexpr std::uint8_t NO_ACTION{16}; //Actions 0-F hold down that key
+
+    Vector_Env(const std::filesystem::path& rom_path, int env_count,
+        Reward_Extractor reward_extractor, Env_Options options = {});
+    ~Vector_Env();
+
+    Vector_Env(const Vector_Env&) = delete;
+    auto operator=(const Vector_Env&) -> Vector_Env& = delete;
+
+    [[nodiscard]] auto size() const -> int;
+
+    //observations: size() * OBSERVATION_BYTES
+    auto reset(std::uint64_t seed, std::uint8_t* observations) -> void;
+    //actions, rewards, dones: size() entries. Does not allocate. An exception thrown while
+    //stepping any environment, e.g. by the reward extractor, is rethrown here
+    auto step(const std::uint8_t* actions, std::uint8_t* observations, float* rewards, std::uint8_t* dones) -> void;
+    //hashes: size() entries, Chip8::get_state_hash() of every environment for deduplication
+    auto get_state_hashes(std::uint64_t* hashes) const -> void;
+
+private:
+    struct Env
+    {
+        Chip8 chip8{};
+        Pcg32 random{};         //No-op frames and the seed of every episode
+        std::uint64_t stream{}; //Index of the environment, selects its random streams
+        int score{};
+        int episode_frames{};
+        std::uint8_t held_key{NO_ACTION};
+    };
+
+    struct Step_Buffers
+    {
+        const std::uint8_t* actions;
+        std::uint8_t* observations;
+        float* rewards;
+        std::uint8_t* dones;
+    };
+
+    auto run_batch(const Step_Buffers& buffers) -> void;
+    auto worker(unsigned int worker_index) -> void;
+    auto process_range(unsigned int worker_index) -> void;
+
+    auto reset_env(Env& env) -> void;
+    auto step_env(Env& env, std::uint8_t action, float& reward, std::uint8_t& done) -> void;
+    [[nodiscard]] auto is_done(const Env& env) const -> bool;
+
+    Chip8 m_initial_state{};
+    Reward_Extractor m_reward_extractor{};
+    Env_Options m_options{};
+    std::vector<std::unique_ptr<Env>> m_envs{};
+
+    //Workers and the calling thread meet at the barrier once to start and once to finish a batch
+    unsigned int m_thread_count{1};
+    std::barrier<> m_barrier;
+    std::vector<std::jthread> m_workers{};
+    std::vector<std::exception_ptr> m_errors{}; //One slot per thread, rethrown by the calling thread
+    Step_Buffers m_buffers{};
+    bool m_resetting{false};
+    std::atomic_bool m_shutdown{false};
+};
+
+#endif //RL_ENV_H
@@ -0,0 +1,445 @@
+//
+// ROM loading from files, directories and tar archives, and the database of ROM settings.
+//
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "rom_library.h"
+
+
+namespace
+{
+    constexpr std::size_t TAR_BLOCK_SIZE{512};
+
+    auto is_rom_name(const std::filesystem::path& path) -> bool
+    {
+        const auto extension = path.extension();
+        return extension == ".ch8" or extension == ".c8";
+    }
+
+    auto is_archive_name(const std::filesystem::path& path) -> bool
+    {
+        return path.extension() == ".tar";
+    }
+
+    //Tar header fields are null or space terminated
+    auto get_tar_field(const std::uint8_t* header, const std::size_t offset, const std::size_t size) -> std::string
+    {
+        const auto field = reinterpret_cast<const char*>(header + offset);
+        return {field, strnlen(field, size)};
+    }
+
+    auto parse_octal(const std::string& field) -> std::size_t
+    {
+        std::size_t value{0};
+        for (const auto digit: field)
+        {
+            if (digit < '0' or digit > '7')
+            {
+                break;
+            }
+            value = value * 8 + static_cast<std::size_t>(digit - '0');
+        }
+
+        return value;
+    }
+
+    auto parse_platform(const std::string& name, Rom_Platform& platform) -> bool
+    {
+        for (const auto candidate: {Rom_Platform::CHIP8, Rom_Platform::COSMAC_VIP, Rom_Platform::CHIP_48})
+        {
+            if (name == get_rom_platform_name(candidate))
+            {
+                platform = candidate;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    auto get_modification_time(const std::filesystem::path& path) -> std::int64_t
+    {
+        return std::filesystem::last_write_time(path).time_since_epoch().count();
+    }
+}
+
+
+Mapped_File::Mapped_File(const std::filesystem::path& file_path)
+{
+    const int fd = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat file_status{};
+    if (fd < 0 or fstat(fd, &file_status) != 0 or !S_ISREG(file_status.st_mode))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        throw std::runtime_error("Failed to open " + file_path.string() + "!");
+    }
+
+    m_size = static_cast<std::size_t>(file_status.st_size);
+    if (m_size > 0)
+    {
+        m_mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    if (m_mapping == MAP_FAILED)
+    {
+        m_mapping = nullptr;
+        throw std::runtime_error("Failed to map " + file_path.string() + "!");
+    }
+}
+
+Mapped_File::~Mapped_File()
+{
+    if (m_mapping != nullptr)
+    {
+        munmap(m_mapping, m_size);
+    }
+}
+
+auto Mapped_File::get_bytes() const -> std::span<const std::uint8_t>
+{
+    return {static_cast<const std::uint8_t*>(m_mapping), m_mapping != nullptr ? m_size : 0};
+}
+
+
+Rom_Library::Rom_Library(const std::filesystem::path& path)
+{
+    add(path);
+}
+
+auto Rom_Library::add(const std::filesystem::path& path) -> void
+{
+    if (!std::filesystem::is_directory(path))
+    {
+        if (is_archive_name(path))
+        {
+            add_archive(path);
+        }
+        else
+        {
+            add_file(path);
+        }
+        return;
+    }
+
+    //Sorted, so a library lists the same way on every file system
+    std::vector<std::filesystem::path> paths;
+    for (const auto& entry: std::filesystem::recursive_directory_iterator(path))
+    {
+        if (entry.is_regular_file() and (is_rom_name(entry.path()) or is_archive_name(entry.path())))
+        {
+            paths.push_back(entry.path());
+        }
+    }
+    std::ranges::sort(paths);
+
+    for (const auto& file_path: paths)
+    {
+        if (is_archive_name(file_path))
+        {
+            add_archive(file_path);
+        }
+        else
+        {
+            add_file(file_path);
+        }
+    }
+}
+
+auto Rom_Library::get_entries() const -> std::span<const Rom_Entry>
+{
+    return m_entries;
+}
+
+auto Rom_Library::add_file(const std::filesystem::path& file_path) -> void
+{
+    const auto& file = m_files.emplace_back(std::make_unique<Mapped_File>(file_path));
+    const auto data = file->get_bytes();
+    m_entries.push_back({.name = file_path.string(), .data = data, .hash = compute_sha1(data)});
+}
+
+auto Rom_Library::add_archive(const std::filesystem::path& archive_path) -> void
+{
+    const auto& file = m_files.emplace_back(std::make_unique<Mapped_File>(archive_path));
+    const auto archive = file->get_bytes();
+
+    std::string long_name;
+    for (std::size_t offset{0}; offset + TAR_BLOCK_SIZE <= archive.size();)
+    {
+        const auto header = archive.data() + offset;
+        //Two zero blocks end the archive, the first one is enough to stop
+        if (std::all_of(header, header + TAR_BLOCK_SIZE, [](const std::uint8_t byte) { return byte == 0; }))
+        {
+            break;
+        }
+
+        const auto size = parse_octal(get_tar_field(header, 124, 12));
+        const auto type = static_cast<char>(header[156]);
+        const auto data_offset = offset + TAR_BLOCK_SIZE;
+        if (data_offset + size > archive.size())
+        {
+            throw std::runtime_error(archive_path.string() + " is truncated!");
+        }
+        const auto data = archive.subspan(data_offset, size);
+        offset = data_offset + (size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+
+        //GNU tar stores names longer than 100 characters as an extra member before the file
+        if (type == 'L')
+        {
+            long_name.assign(reinterpret_cast<const char*>(data.data()), strnlen(reinterpret_cast<const char*>(data.data()), size));
+            continue;
+        }
+
+        std::string name = get_tar_field(header, 0, 100);
+        const auto prefix = get_tar_field(header, 345, 155);
+        if (!long_name.empty())
+        {
+            name = std::move(long_name);
+            long_name.clear();
+        }
+        else if (!prefix.empty() and std::memcmp(header + 257, "ustar", 5) == 0)
+        {
+            name = prefix + "/" + name;
+        }
+
+        if ((type == '0' or type == '\0') and is_rom_name(name))
+        {
+            m_entries.push_back({.name = archive_path.string() + ":" + name, .data = data, .hash = compute_sha1(data)});
+        }
+    }
+}
+
+
+Rom_Database::Rom_Database(const std::filesystem::path& database_path)
+{
+    const auto index_path = get_index_path(database_path);
+    if (std::filesystem::exists(index_path))
+    {
+        auto index_file = std::make_unique<Mapped_File>(index_path);
+        if (is_valid_index(index_file->get_bytes(), database_path))
+        {
+            m_index_file = std::move(index_file);
+            m_index = m_index_file->get_bytes();
+            return;
+        }
+    }
+
+    m_index_buffer = build_index(database_path);
+    m_index = m_index_buffer;
+
+    //Written next to the database and renamed, so a concurrent start never maps half an index.
+    //A database in a read only place works from the buffer
+    auto temporary_path = index_path;
+    temporary_path += ".tmp" + std::to_string(getpid());
+    std::ofstream index(temporary_path, std::ios::binary | std::ios::out | std::ios::trunc);
+    index.write(reinterpret_cast<const char*>(m_index_buffer.data()), static_cast<std::streamsize>(m_index_buffer.size()));
+    index.close();
+
+    std::error_code error;
+    if (index.good())
+    {
+        std::filesystem::rename(temporary_path, index_path, error);
+    }
+    std::filesystem::remove(temporary_path, error);
+}
+
+auto Rom_Database::find(const Sha1_Digest& hash) const -> std::optional<Rom_Profile>
+{
+    Rom_Index_Header header{};
+    std::memcpy(&header, m_index.data(), sizeof(header));
+    const auto records = m_index.subspan(sizeof(header), std::size_t{header.record_count} * sizeof(Rom_Index_Record));
+    const auto names = m_index.subspan(sizeof(header) + records.size());
+
+    const auto get_record = [&records](const std::size_t i)
+    {
+        Rom_Index_Record record{};
+        std::memcpy(&record, records.data() + i * sizeof(record), sizeof(record));
+        return record;
+    };
+
+    std::size_t low{0};
+    std::size_t high{header.record_count};
+    while (low < high)
+    {
+        const auto middle = low + (high - low) / 2;
+        if (get_record(middle).hash < hash)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    if (low == header.record_count)
+    {
+        return std::nullopt;
+    }
+
+    const auto record = get_record(low);
+    if (record.hash != hash)
+    {
+        return std::nullopt;
+    }
+
+    const auto name = reinterpret_cast<const char*>(names.data() + record.name_offset);
+    return Rom_Profile{
+        .name = std::string(name, strnlen(name, names.size() - record.name_offset)),
+        .platform = record.platform,
+        .instructions_per_frame = record.instructions_per_frame,
+        .cycle_time = record.cycle_time,
+    };
+}
+
+auto Rom_Database::size() const -> std::size_t
+{
+    Rom_Index_Header header{};
+    std::memcpy(&header, m_index.data(), sizeof(header));
+    return header.record_count;
+}
+
+auto Rom_Database::get_index_path(const std::filesystem::path& database_path) -> std::filesystem::path
+{
+    auto index_path = database_path;
+    index_path += ".idx";
+    return index_path;
+}
+
+auto Rom_Database::build_index(const std::filesystem::path& database_path) -> std::vector<std::uint8_t>
+{
+    std::ifstream database(database_path);
+    if (!database.good())
+    {
+        throw std::runtime_error("Failed to open ROM database " + database_path.string() + "!");
+    }
+
+    std::vector<Rom_Index_Record> records;
+    std::string names;
+    std::string line;
+    for (int line_number{1}; std::getline(database, line); line_number++)
+    {
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream tokens(line);
+        std::string hash;
+        if (!(tokens >> hash))
+        {
+            continue;
+        }
+
+        Rom_Index_Record record{};
+        int instructions_per_frame{};
+        int cycle_time{};
+        std::string platform;
+        if (!parse_sha1(hash, record.hash) or !(tokens >> instructions_per_frame >> cycle_time >> platform)
+            or instructions_per_frame < 0 or instructions_per_frame > UINT16_MAX
+            or cycle_time < 0 or cycle_time > UINT16_MAX
+            or !parse_platform(platform, record.platform))
+        {
+            throw std::runtime_error("Invalid entry in line " + std::to_string(line_number)
+                + " of the ROM database!");
+        }
+        record.instructions_per_frame = static_cast<std::uint16_t>(instructions_per_frame);
+        record.cycle_time = static_cast<std::uint16_t>(cycle_time);
+
+        std::string name;
+        std::getline(tokens >> std::ws, name);
+        while (!name.empty() and std::isspace(static_cast<unsigned char>(name.back())))
+        {
+            name.pop_back();
+        }
+        record.name_offset = static_cast<std::uint32_t>(names.size());
+        names += name;
+        names += '\0';
+
+        records.push_back(record);
+    }
+
+    //A later line for the same ROM replaces an earlier one
+    std::ranges::stable_sort(records, {}, &Rom_Index_Record::hash);
+    const auto duplicates = std::ranges::unique(records.rbegin(), records.rend(), {}, &Rom_Index_Record::hash);
+    records.erase(records.begin(), records.begin() + (duplicates.end() - duplicates.begin()));
+
+    const Rom_Index_Header header{
+        .record_size = sizeof(Rom_Index_Record),
+        .record_count = static_cast<std::uint32_t>(records.size()),
+        .names_size = static_cast<std::uint32_t>(names.size()),
+        .source_size = std::filesystem::file_size(database_path),
+        .source_time = get_modification_time(database_path),
+    };
+
+    std::vector<std::uint8_t> index(sizeof(header) + records.size() * sizeof(Rom_Index_Record) + names.size());
+    std::memcpy(index.data(), &header, sizeof(header));
+    std::memcpy(index.data() + sizeof(header), records.data(), records.size() * sizeof(Rom_Index_Record));
+    std::memcpy(index.data() + sizeof(header) + records.size() * sizeof(Rom_Index_Record), names.data(), names.size());
+
+    return index;
+}
+
+auto Rom_Database::is_valid_index(const std::span<const std::uint8_t> index,
+    const std::filesystem::path& database_path) const -> bool
+{
+    Rom_Index_Header header{};
+    if (index.size() < sizeof(header))
+    {
+        return false;
+    }
+    std::memcpy(&header, index.data(), sizeof(header));
+
+    const auto is_complete = header.magic == Rom_Index_Header{}.magic
+        and header.version == Rom_Index_Header{}.version
+        and header.record_size == sizeof(Rom_Index_Record)
+        and index.size() == sizeof(header) + std::size_t{header.record_count} * sizeof(Rom_Index_Record) + header.names_size;
+    if (!is_complete)
+    {
+        return false;
+    }
+
+    //find() reads the name at the offset without checking it, a corrupt record would read past the mapping
+    for (std::size_t i{0}; i < header.record_count; i++)
+    {
+        Rom_Index_Record record{};
+        std::memcpy(&record, index.data() + sizeof(header) + i * sizeof(record), sizeof(record));
+        if (record.name_offset >= header.names_size)
+        {
+            return false;
+        }
+    }
+
+    //Without the text database the index is all there is
+    std::error_code error;
+    const auto source_size = std::filesystem::file_size(database_path, error);
+    if (error)
+    {
+        return true;
+    }
+
+    return header.source_size == source_size
+        and header.source_time == get_modification_time(database_path);
+}
+
+auto get_rom_platform_name(const Rom_Platform platform) -> const char*
+{
+    switch (platform)
+    {
+    case Rom_Platform::CHIP8: return "chip8";
+    case Rom_Platform::COSMAC_VIP: return "vip";
+    case Rom_Platform::CHIP_48: return "chip48";
+    }
+
+    return "unknown";
+}
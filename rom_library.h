@@ -0,0 +1,139 @@
+//
+// ROM loading from files, directories and tar archives, and the database of ROM settings.
+//
+
+#ifndef ROM_LIBRARY_H
+#define ROM_LIBRARY_H
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "sha1.h"
+
+
+//Read only mapping of a whole file, empty files have no mapping
+class Mapped_File
+{
+public:
+    explicit Mapped_File(const std::filesystem::path& file_path);
+    ~Mapped_File();
+
+    Mapped_File(const Mapped_File&) = delete;
+    auto operator=(const Mapped_File&) -> Mapped_File& = delete;
+
+    [[nodiscard]] auto get_bytes() const -> std::span<const std::uint8_t>;
+
+private:
+    void* m_mapping{nullptr};
+    std::size_t m_size{};
+};
+
+
+struct Rom_Entry
+{
+    std::string name{}; //Path of the file, archive members as <archive>:<member>
+    std::span<const std::uint8_t> data{}; //Into a mapping owned by the library
+    Sha1_Digest hash{};
+};
+
+/*
+ * ROMs are mapped, not read, and hashed once when they are added. Directories are
+ * searched recursively for .ch8 and .c8 files and uncompressed .tar archives, archive
+ * members are taken by the same extensions. A path given directly is always a ROM
+ * unless it is a directory or a .tar archive.
+ */
+class Rom_Library
+{
+public:
+    Rom_Library() = default;
+    explicit Rom_Library(const std::filesystem::path& path);
+
+    auto add(const std::filesystem::path& path) -> void;
+    [[nodiscard]] auto get_entries() const -> std::span<const Rom_Entry>;
+
+private:
+    auto add_file(const std::filesystem::path& file_path) -> void;
+    auto add_archive(const std::filesystem::path& archive_path) -> void;
+
+    std::vector<std::unique_ptr<Mapped_File>> m_files{};
+    std::vector<Rom_Entry> m_entries{};
+};
+
+
+enum class Rom_Platform: std::uint8_t
+{
+    CHIP8, COSMAC_VIP, CHIP_48,
+};
+
+struct Rom_Profile
+{
+    std::string name{};
+    Rom_Platform platform{Rom_Platform::CHIP8};
+    int instructions_per_frame{11};
+    int cycle_time{16};
+};
+
+struct Rom_Index_Header
+{
+    std::array<char, 4> magic{'C', '8', 'D', 'B'};
+    std::uint8_t version{1};
+    std::uint8_t record_size{};
+    std::uint16_t reserved{};
+    std::uint32_t record_count{};
+    std::uint32_t names_size{};
+    std::uint64_t source_size{}; //Size and modification time of the text database it was built from
+    std::int64_t source_time{};
+};
+
+static_assert(sizeof(Rom_Index_Header) == 32);
+
+struct Rom_Index_Record
+{
+    Sha1_Digest hash;
+    std::uint32_t name_offset; //Into the null terminated names after the records
+    std::uint16_t instructions_per_frame;
+    std::uint16_t cycle_time;
+    Rom_Platform platform;
+    std::array<std::uint8_t, 3> reserved;
+};
+
+static_assert(sizeof(Rom_Index_Record) == 32);
+
+/*
+ * Text database, one ROM per line, '#' starts a comment:
+ *
+ *   <sha1> <instructions per frame> <cycle time (ms)> <chip8|vip|chip48> [name]
+ *
+ * The parsed database is cached next to it as <database>.idx: a header, the records
+ * sorted by hash and their names. The index is rebuilt when the text file changes and
+ * lookups binary search its mapping, so opening a large database parses nothing.
+ */
+class Rom_Database
+{
+public:
+    explicit Rom_Database(const std::filesystem::path& database_path);
+
+    [[nodiscard]] auto find(const Sha1_Digest& hash) const -> std::optional<Rom_Profile>;
+    [[nodiscard]] auto size() const -> std::size_t;
+
+    [[nodiscard]] static auto get_index_path(const std::filesystem::path& database_path) -> std::filesystem::path;
+    [[nodiscard]] static auto build_index(const std::filesystem::path& database_path) -> std::vector<std::uint8_t>;
+
+private:
+    [[nodiscard]] auto is_valid_index(std::span<const std::uint8_t> index,
+        const std::filesystem::path& database_path) const -> bool;
+
+    std::unique_ptr<Mapped_File> m_index_file{};
+    std::vector<std::uint8_t> m_index_buffer{}; //Used when the index could not be written
+    std::span<const std::uint8_t> m_index{};
+};
+
+[[nodiscard]] auto get_rom_platform_name(Rom_Platform platform) -> const char*;
+
+#endif //ROM_LIBRARY_H
@@ -0,0 +1,189 @@
+//
+// Hosts many interactive interpreter sessions on one thread.
+//
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "control_server.h"
+#include "session_host.h"
+
+
+namespace
+{
+    constexpr std::uint8_t RELEASE_FLAG{0x10};
+}
+
+
+Session_Host::Session_Host(std::filesystem::path socket_path, const std::filesystem::path& rom_path,
+    const int cycle_time, const int instructions_per_frame, const bool vip_timing, const std::uint64_t seed)
+    : m_socket_path(std::move(socket_path)),
+      m_frame_period(std::chrono::milliseconds(std::max(cycle_time, 1))),
+      m_instructions_per_frame(instructions_per_frame),
+      m_seed(seed)
+{
+    if (vip_timing)
+    {
+        auto cosmac_vip = std::make_unique<COSMAC_VIP>();
+        cosmac_vip->set_timing_model({.enabled = true});
+        m_prototype = std::move(cosmac_vip);
+    }
+    else
+    {
+        m_prototype = std::make_unique<Chip8>();
+    }
+    m_prototype->read_rom(rom_path);
+
+    //The destructor does not run when the constructor throws, so whatever was set up is released here
+    try
+    {
+        open_resources();
+    }
+    catch (...)
+    {
+        close_resources();
+        throw;
+    }
+}
+
+Session_Host::~Session_Host()
+{
+    close_resources();
+}
+
+auto Session_Host::run() -> void
+{
+    std::printf("Hosting sessions on %s\n", m_socket_path.c_str());
+    std::fflush(stdout);
+
+    m_scheduler.spawn(accept_sessions());
+    m_scheduler.run();
+}
+
+auto Session_Host::accept_sessions() -> Session_Scheduler::Task
+{
+    while (true)
+    {
+        co_await m_scheduler.wait(m_socket_fd, Session_Scheduler::NO_DEADLINE);
+
+        //Drain the backlog, the listening socket is non blocking
+        for (int client_fd = accept4(m_socket_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+             client_fd >= 0;
+             client_fd = accept4(m_socket_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC))
+        {
+            m_scheduler.spawn(run_session(client_fd));
+        }
+
+        if (errno != EAGAIN and errno != EWOULDBLOCK and errno != EINTR)
+        {
+            throw std::runtime_error("Failed to accept session connection!");
+        }
+    }
+}
+
+auto Session_Host::run_session(const int client_fd) -> Session_Scheduler::Task
+{
+    //Closes the connection however the session ends
+    const std::unique_ptr<const int, decltype([](const int* fd) { close(*fd); })> connection{&client_fd};
+
+    const auto chip8 = m_prototype->fork();
+    chip8->seed_random(m_seed, m_sessions_started++);
+    std::array<std::uint8_t, Chip8::PACKED_DISPLAY_BYTES> frame{};
+    std::array<std::uint8_t, 256> input{};
+
+    auto next_frame = Session_Scheduler::Clock::now();
+    while (true)
+    {
+        const auto wake_reason = co_await m_scheduler.wait(client_fd, next_frame);
+
+        if (wake_reason == Session_Scheduler::Wake_Reason::READABLE)
+        {
+            const auto received = recv(client_fd, input.data(), input.size(), 0);
+            if (received == 0 or (received < 0 and errno != EAGAIN and errno != EWOULDBLOCK and errno != EINTR))
+            {
+                co_return;
+            }
+
+            for (std::ptrdiff_t i{0}; i < received; i++)
+            {
+                const std::uint8_t key = input[i] & 0x0F;
+                if (input[i] & RELEASE_FLAG)
+                {
+                    chip8->release_key(key);
+                }
+                else
+                {
+                    chip8->press_key(key);
+                }
+            }
+            continue;
+        }
+
+        chip8->run_frame(m_instructions_per_frame);
+        chip8->update_timer();
+
+        chip8->get_packed_display(frame);
+        const auto sent = send(client_fd, frame.data(), frame.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0 and errno != EAGAIN and errno != EWOULDBLOCK)
+        {
+            co_return;
+        }
+
+        //A session that fell behind skips the missed frames instead of running them back to back
+        next_frame += m_frame_period;
+        const auto now = Session_Scheduler::Clock::now();
+        if (next_frame < now)
+        {
+            next_frame = now + m_frame_period;
+        }
+    }
+}
+
+auto Session_Host::open_resources() -> void
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (m_socket_path.native().size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("Socket path is too long!");
+    }
+    std::ranges::copy(m_socket_path.native(), address.sun_path);
+
+    m_socket_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_socket_fd < 0)
+    {
+        throw std::runtime_error("Failed to create session socket!");
+    }
+
+    if (!remove_socket_file(m_socket_path))
+    {
+        throw std::runtime_error("Socket path exists and is not a socket!");
+    }
+    if (bind(m_socket_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        close(m_socket_fd);
+        m_socket_fd = -1;
+        throw std::runtime_error("Failed to bind session socket!");
+    }
+
+    if (listen(m_socket_fd, SOMAXCONN) != 0)
+    {
+        throw std::runtime_error("Failed to listen on session socket!");
+    }
+}
+
+auto Session_Host::close_resources() -> void
+{
+    if (m_socket_fd >= 0)
+    {
+        close(m_socket_fd);
+        m_socket_fd = -1;
+        remove_socket_file(m_socket_path);
+    }
+}
@@ -0,0 +1,57 @@
+//
+// Hosts many interactive interpreter sessions on one thread.
+//
+
+#ifndef SESSION_HOST_H
+#define SESSION_HOST_H
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+
+#include "main.h"
+#include "session_scheduler.h"
+
+
+/*
+ * Binary protocol over a Unix domain SOCK_SEQPACKET socket, one session per connection:
+ *
+ *   client -> host   one byte per key event, 0x00-0x0F presses and 0x10-0x1F releases a key
+ *   host -> client   once per frame one message with the display packed to 256 bytes,
+ *                    row major, most significant bit first
+ *
+ * Frames a slow client cannot take are dropped whole instead of buffered. Every session
+ * starts from a fork of the same loaded machine, so the ROM pages are shared, and
+ * draws its random numbers from its own stream of the host seed.
+ */
+class Session_Host
+{
+public:
+    //A frame runs every cycle_time milliseconds, like in the terminal
+    Session_Host(std::filesystem::path socket_path, const std::filesystem::path& rom_path,
+        int cycle_time, int instructions_per_frame, bool vip_timing, std::uint64_t seed);
+    ~Session_Host();
+
+    Session_Host(const Session_Host&) = delete;
+    auto operator=(const Session_Host&) -> Session_Host& = delete;
+
+    auto run() -> void;
+
+private:
+    auto accept_sessions() -> Session_Scheduler::Task;
+    auto run_session(int client_fd) -> Session_Scheduler::Task;
+    auto open_resources() -> void;
+    auto close_resources() -> void;
+
+    std::filesystem::path m_socket_path{};
+    std::chrono::nanoseconds m_frame_period{};
+    int m_instructions_per_frame{};
+    int m_socket_fd{-1};
+    std::uint64_t m_seed{};
+    std::uint64_t m_sessions_started{0};
+
+    std::unique_ptr<Chip8> m_prototype{};
+    Session_Scheduler m_scheduler{};
+};
+
+#endif //SESSION_HOST_H
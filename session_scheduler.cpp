@@ -0,0 +1,173 @@
+//
+// Single threaded C++20 coroutine scheduler for many interpreter sessions.
+//
+
+#include <array>
+#include <cstdio>
+#include <stdexcept>
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "session_scheduler.h"
+
+
+auto Session_Scheduler::Wait_Awaiter::await_suspend(const Handle suspended) -> void
+{
+    handle = suspended;
+    auto& promise = handle.promise();
+    promise.wait_generation++;
+
+    if (fd != NO_FD and fd != promise.watched_fd)
+    {
+        scheduler.watch(handle, fd);
+    }
+
+    if (deadline != NO_DEADLINE)
+    {
+        scheduler.m_timers.push({deadline, promise.session_id, promise.wait_generation});
+    }
+}
+
+
+Session_Scheduler::Session_Scheduler()
+    : m_epoll_fd(epoll_create1(EPOLL_CLOEXEC))
+{
+    if (m_epoll_fd < 0)
+    {
+        throw std::runtime_error("Failed to create epoll instance!");
+    }
+}
+
+Session_Scheduler::~Session_Scheduler()
+{
+    for (auto& [session_id, handle]: m_sessions)
+    {
+        handle.destroy();
+    }
+    close(m_epoll_fd);
+}
+
+auto Session_Scheduler::spawn(const Task task) -> void
+{
+    const auto session_id = m_next_session_id++;
+    task.handle.promise().session_id = session_id;
+    m_sessions.emplace(session_id, task.handle);
+
+    m_timers.push({Clock::now(), session_id, task.handle.promise().wait_generation});
+}
+
+auto Session_Scheduler::run() -> void
+{
+    std::array<epoll_event, 64> events{};
+
+    while (m_run and !m_sessions.empty())
+    {
+        //Sleep until the earliest deadline, rounded up to whole milliseconds
+        int timeout_ms{-1};
+        if (!m_timers.empty())
+        {
+            const auto remaining = m_timers.top().deadline - Clock::now();
+            timeout_ms = std::max<int>(0, std::chrono::ceil<std::chrono::milliseconds>(remaining).count());
+        }
+
+        const int event_count = epoll_wait(m_epoll_fd, events.data(), events.size(), timeout_ms);
+        if (event_count < 0 and errno != EINTR)
+        {
+            throw std::runtime_error("Failed to wait for session events!");
+        }
+
+        for (int i{0}; i < event_count; i++)
+        {
+            resume(events[i].data.u64, Wake_Reason::READABLE);
+        }
+
+        const auto now = Clock::now();
+        while (!m_timers.empty() and m_timers.top().deadline <= now)
+        {
+            const auto timer = m_timers.top();
+            m_timers.pop();
+
+            const auto session = m_sessions.find(timer.session_id);
+            if (session != m_sessions.end() and session->second.promise().wait_generation == timer.wait_generation)
+            {
+                resume(timer.session_id, Wake_Reason::DEADLINE);
+            }
+        }
+    }
+}
+
+auto Session_Scheduler::stop() -> void
+{
+    m_run = false;
+}
+
+auto Session_Scheduler::wait(const int fd, const Clock::time_point deadline) -> Wait_Awaiter
+{
+    return {*this, fd, deadline};
+}
+
+auto Session_Scheduler::get_session_count() const -> std::size_t
+{
+    return m_sessions.size();
+}
+
+auto Session_Scheduler::resume(const std::uint64_t session_id, const Wake_Reason wake_reason) -> void
+{
+    const auto session = m_sessions.find(session_id);
+    if (session == m_sessions.end())
+    {
+        return;
+    }
+
+    const auto handle = session->second;
+    handle.promise().wake_reason = wake_reason;
+    //Invalidates the timer of the wait that ends here
+    handle.promise().wait_generation++;
+    handle.resume();
+
+    if (!handle.done())
+    {
+        return;
+    }
+
+    if (const auto exception = handle.promise().exception)
+    {
+        try
+        {
+            std::rethrow_exception(exception);
+        }
+        catch (const std::exception& e)
+        {
+            std::fprintf(stderr, "Session %llu ended: %s\n", static_cast<unsigned long long>(session_id), e.what());
+        }
+    }
+
+    if (handle.promise().watched_fd != NO_FD)
+    {
+        epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, handle.promise().watched_fd, nullptr);
+    }
+
+    handle.destroy();
+    //The session may have spawned others, which can invalidate iterators
+    m_sessions.erase(session_id);
+}
+
+auto Session_Scheduler::watch(const Handle handle, const int fd) -> void
+{
+    auto& promise = handle.promise();
+    if (promise.watched_fd != NO_FD)
+    {
+        epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, promise.watched_fd, nullptr);
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.u64 = promise.session_id;
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        throw std::runtime_error("Failed to watch session file descriptor!");
+    }
+
+    promise.watched_fd = fd;
+}
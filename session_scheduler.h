@@ -0,0 +1,106 @@
+//
+// Single threaded C++20 coroutine scheduler for many interpreter sessions.
+//
+
+#ifndef SESSION_SCHEDULER_H
+#define SESSION_SCHEDULER_H
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+
+/*
+ * Each session is a coroutine that suspends until a deadline passes or a file
+ * descriptor becomes readable. One event loop waits in epoll for the earliest
+ * deadline and resumes whichever sessions are due, so the number of threads does
+ * not grow with the number of sessions.
+ */
+class Session_Scheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Wake_Reason: std::uint8_t
+    {
+        DEADLINE, READABLE,
+    };
+
+    struct Task
+    {
+        struct promise_type
+        {
+            std::uint64_t session_id{};
+            std::uint64_t wait_generation{}; //Timer entries of earlier waits are stale
+            Wake_Reason wake_reason{};
+            int watched_fd{-1};
+            std::exception_ptr exception{};
+
+            auto get_return_object() -> Task { return Task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+            auto initial_suspend() noexcept -> std::suspend_always { return {}; }
+            auto final_suspend() noexcept -> std::suspend_always { return {}; }
+            auto return_void() -> void {}
+            auto unhandled_exception() -> void { exception = std::current_exception(); }
+        };
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    using Handle = std::coroutine_handle<Task::promise_type>;
+
+    struct Wait_Awaiter
+    {
+        Session_Scheduler& scheduler;
+        int fd;
+        Clock::time_point deadline;
+        Handle handle{};
+
+        auto await_ready() const noexcept -> bool { return false; }
+        auto await_suspend(Handle suspended) -> void;
+        auto await_resume() const -> Wake_Reason { return handle.promise().wake_reason; }
+    };
+
+    static constexpr auto NO_DEADLINE{Clock::time_point::max()};
+    static constexpr int NO_FD{-1};
+
+    Session_Scheduler();
+    ~Session_Scheduler();
+
+    Session_Scheduler(const Session_Scheduler&) = delete;
+    auto operator=(const Session_Scheduler&) -> Session_Scheduler& = delete;
+
+    //Starts the session on the next loop iteration
+    auto spawn(Task task) -> void;
+    //Runs until stop() is called or no session is left
+    auto run() -> void;
+    auto stop() -> void;
+
+    //co_await wait(fd, deadline) inside a session, a file descriptor stays watched until the session ends
+    [[nodiscard]] auto wait(int fd, Clock::time_point deadline) -> Wait_Awaiter;
+    [[nodiscard]] auto get_session_count() const -> std::size_t;
+
+private:
+    struct Timer
+    {
+        Clock::time_point deadline;
+        std::uint64_t session_id;
+        std::uint64_t wait_generation;
+
+        auto operator>(const Timer& other) const -> bool { return deadline > other.deadline; }
+    };
+
+    auto resume(std::uint64_t session_id, Wake_Reason wake_reason) -> void;
+    auto watch(Handle handle, int fd) -> void;
+
+    int m_epoll_fd{-1};
+    bool m_run{true};
+    std::uint64_t m_next_session_id{1};
+    std::unordered_map<std::uint64_t, Handle> m_sessions{};
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<>> m_timers{};
+};
+
+#endif //SESSION_SCHEDULER_H
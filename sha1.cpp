@@ -0,0 +1,149 @@
+//
+// SHA-1 content hashes identifying ROMs.
+//
+
+#include <algorithm>
+#include <bit>
+
+#include "sha1.h"
+
+
+namespace
+{
+    constexpr std::size_t BLOCK_SIZE{64};
+
+    auto process_block(std::array<std::uint32_t, 5>& state, const std::uint8_t* block) -> void
+    {
+        std::array<std::uint32_t, 80> words{};
+        for (std::size_t i{0}; i < 16; i++)
+        {
+            words[i] = std::uint32_t{block[i * 4]} << 24 | std::uint32_t{block[i * 4 + 1]} << 16
+                | std::uint32_t{block[i * 4 + 2]} << 8 | block[i * 4 + 3];
+        }
+        for (std::size_t i{16}; i < words.size(); i++)
+        {
+            words[i] = std::rotl(words[i - 3] ^ words[i - 8] ^ words[i - 14] ^ words[i - 16], 1);
+        }
+
+        auto [a, b, c, d, e] = state;
+        for (std::size_t i{0}; i < words.size(); i++)
+        {
+            std::uint32_t f;
+            std::uint32_t k;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+
+            const auto temp = std::rotl(a, 5) + f + e + k + words[i];
+            e = d;
+            d = c;
+            c = std::rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+
+
+auto compute_sha1(const std::span<const std::uint8_t> data) -> Sha1_Digest
+{
+    std::array<std::uint32_t, 5> state{0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    const auto full_blocks = data.size() / BLOCK_SIZE;
+    for (std::size_t block{0}; block < full_blocks; block++)
+    {
+        process_block(state, data.data() + block * BLOCK_SIZE);
+    }
+
+    //The rest, a 1 bit, zeros and the length in bits fill one or two final blocks
+    std::array<std::uint8_t, BLOCK_SIZE * 2> tail{};
+    const auto rest = data.subspan(full_blocks * BLOCK_SIZE);
+    std::ranges::copy(rest, tail.begin());
+    tail[rest.size()] = 0x80;
+
+    const auto tail_size = rest.size() + 9 <= BLOCK_SIZE ? BLOCK_SIZE : BLOCK_SIZE * 2;
+    const std::uint64_t bit_count = std::uint64_t{data.size()} * 8;
+    for (std::size_t i{0}; i < 8; i++)
+    {
+        tail[tail_size - 1 - i] = static_cast<std::uint8_t>(bit_count >> (i * 8));
+    }
+    for (std::size_t offset{0}; offset < tail_size; offset += BLOCK_SIZE)
+    {
+        process_block(state, tail.data() + offset);
+    }
+
+    Sha1_Digest digest{};
+    for (std::size_t i{0}; i < digest.size(); i++)
+    {
+        digest[i] = static_cast<std::uint8_t>(state[i / 4] >> (24 - i % 4 * 8));
+    }
+
+    return digest;
+}
+
+auto format_sha1(const Sha1_Digest& digest) -> std::string
+{
+    constexpr std::string_view HEX_DIGITS{"0123456789abcdef"};
+
+    std::string text;
+    text.reserve(digest.size() * 2);
+    for (const auto byte: digest)
+    {
+        text += HEX_DIGITS[byte >> 4];
+        text += HEX_DIGITS[byte & 0xF];
+    }
+
+    return text;
+}
+
+auto parse_sha1(const std::string_view text, Sha1_Digest& digest) -> bool
+{
+    if (text.size() != digest.size() * 2)
+    {
+        return false;
+    }
+
+    const auto parse_digit = [](const char digit) -> int
+    {
+        if (digit >= '0' and digit <= '9') return digit - '0';
+        if (digit >= 'a' and digit <= 'f') return digit - 'a' + 10;
+        if (digit >= 'A' and digit <= 'F') return digit - 'A' + 10;
+        return -1;
+    };
+
+    for (std::size_t i{0}; i < digest.size(); i++)
+    {
+        const auto high = parse_digit(text[i * 2]);
+        const auto low = parse_digit(text[i * 2 + 1]);
+        if (high < 0 or low < 0)
+        {
+            return false;
+        }
+        digest[i] = static_cast<std::uint8_t>(high << 4 | low);
+    }
+
+    return true;
+}
@@ -0,0 +1,24 @@
+//
+// SHA-1 content hashes identifying ROMs.
+//
+
+#ifndef SHA1_H
+#define SHA1_H
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+
+//The hash ROM databases are keyed by, not used for anything security related
+using Sha1_Digest = std::array<std::uint8_t, 20>;
+
+[[nodiscard]] auto compute_sha1(std::span<const std::uint8_t> data) -> Sha1_Digest;
+//Lowercase hex, 40 characters
+[[nodiscard]] auto format_sha1(const Sha1_Digest& digest) -> std::string;
+//False if the text is not 40 hex digits
+[[nodiscard]] auto parse_sha1(std::string_view text, Sha1_Digest& digest) -> bool;
+
+#endif //SHA1_H
@@ -0,0 +1,61 @@
+//
+// Bounded lock-free single-producer/single-consumer queue.
+//
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+
+
+/*
+ * One thread pushes, one other thread pops. Head and tail live on separate cache
+ * lines, so producer and consumer only share a line when they touch the same item.
+ */
+template<typename T, std::size_t Capacity>
+class Spsc_Queue
+{
+    static_assert(std::has_single_bit(Capacity), "Capacity must be a power of two");
+
+public:
+    [[nodiscard]] auto try_push(const T& item) -> bool
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+
+        m_items[tail % Capacity] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]] auto try_pop(T& item) -> bool
+    {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        item = m_items[head % Capacity];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]] auto empty() const -> bool
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(64) std::atomic_size_t m_head{0};
+    alignas(64) std::atomic_size_t m_tail{0};
+    alignas(64) std::array<T, Capacity> m_items{};
+};
+
+#endif //SPSC_QUEUE_H
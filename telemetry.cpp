@@ -0,0 +1,169 @@
+//
+// Runtime counters and histograms published as a text exposition file.
+//
+
+#include <algorithm>
+#include <bit>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+
+#include "telemetry.h"
+
+
+auto Histogram::record(const std::uint64_t value) -> void
+{
+    m_buckets[std::min<std::size_t>(std::bit_width(value), BUCKET_COUNT - 1)]++;
+    m_sum += value;
+    m_count++;
+}
+
+auto Histogram::write_exposition(std::ostream& out, const char* name, const char* help) const -> void
+{
+    out << "# HELP " << name << ' ' << help << '\n';
+    out << "# TYPE " << name << " histogram\n";
+
+    //Bucket n holds values below 2^n
+    std::uint64_t cumulative{0};
+    for (std::size_t bucket{0}; bucket < BUCKET_COUNT - 1; bucket++)
+    {
+        cumulative += m_buckets[bucket];
+        out << name << "_bucket{le=\"" << (std::uint64_t{1} << bucket) - 1 << "\"} " << cumulative << '\n';
+    }
+    cumulative += m_buckets[BUCKET_COUNT - 1];
+
+    out << name << "_bucket{le=\"+Inf\"} " << cumulative << '\n';
+    out << name << "_sum " << m_sum << '\n';
+    out << name << "_count " << m_count << '\n';
+}
+
+
+auto Telemetry::publish(const Telemetry_Frame& frame) -> void
+{
+    if (m_frames.try_push({.frame = frame, .lost_frames = m_lost_frames}))
+    {
+        m_lost_frames = 0;
+        return;
+    }
+
+    m_lost_frames++;
+}
+
+auto Telemetry::collect() -> void
+{
+    Published_Frame published_frame{};
+    while (m_frames.try_pop(published_frame))
+    {
+        const auto& [frame, lost_frames] = published_frame;
+
+        m_instructions = frame.instructions;
+        m_frame_count += 1 + lost_frames;
+        m_lost_frame_count += lost_frames;
+        m_late_frames += frame.late;
+        m_dropped_frames += frame.dropped_frames;
+        m_bytes_written += frame.render_bytes;
+
+        m_frame_time_us.record(frame.frame_time_us);
+        m_frame_jitter_us.record(frame.frame_jitter_us);
+        m_render_time_us.record(frame.render_time_us);
+        m_render_bytes.record(frame.render_bytes);
+
+        const auto key_events = std::min<std::size_t>(frame.key_event_count, Telemetry_Frame::MAX_KEY_EVENTS);
+        for (std::size_t event{0}; event < key_events; event++)
+        {
+            m_input_latency_us.record(frame.input_latency_us[event]);
+        }
+    }
+}
+
+auto Telemetry::get_instructions() const -> std::uint64_t
+{
+    return m_instructions;
+}
+
+auto Telemetry::write_exposition(std::ostream& out, const double instructions_per_second) const -> void
+{
+    const auto write_counter = [&out](const char* name, const char* help, const std::uint64_t value)
+    {
+        out << "# HELP " << name << ' ' << help << '\n';
+        out << "# TYPE " << name << " counter\n";
+        out << name << ' ' << value << '\n';
+    };
+
+    write_counter("chip8_instructions_total", "Executed instructions", m_instructions);
+    write_counter("chip8_frames_total", "Emulated frames", m_frame_count);
+    write_counter("chip8_late_frames_total", "Frames started late", m_late_frames);
+    write_counter("chip8_dropped_frames_total", "Frame periods skipped entirely", m_dropped_frames);
+    write_counter("chip8_render_bytes_total", "Bytes written to the terminal", m_bytes_written);
+    write_counter("chip8_telemetry_lost_frames_total", "Frames missing from the statistics below", m_lost_frame_count);
+
+    out << "# HELP chip8_instructions_per_second Instructions per second over the last interval\n";
+    out << "# TYPE chip8_instructions_per_second gauge\n";
+    out << "chip8_instructions_per_second " << instructions_per_second << '\n';
+
+    m_frame_time_us.write_exposition(out, "chip8_frame_time_us", "Time between frame starts");
+    m_frame_jitter_us.write_exposition(out, "chip8_frame_jitter_us", "Deviation of the frame time from the cycle time");
+    m_render_time_us.write_exposition(out, "chip8_render_time_us", "Time spent drawing the display");
+    m_render_bytes.write_exposition(out, "chip8_render_bytes", "Bytes written per drawn frame");
+    m_input_latency_us.write_exposition(out, "chip8_input_latency_us", "Time from key event to keypad update");
+}
+
+
+Telemetry_Reporter::Telemetry_Reporter(Telemetry& telemetry, std::filesystem::path stats_path,
+    const std::chrono::milliseconds interval)
+    : m_telemetry(telemetry),
+      m_stats_path(std::move(stats_path)),
+      m_interval(interval),
+      m_reporter([this](const std::stop_token& stop_token) { reporter_thread(stop_token); })
+{
+}
+
+auto Telemetry_Reporter::reporter_thread(const std::stop_token& stop_token) -> void
+{
+    std::mutex mutex;
+    std::condition_variable_any wake_up;
+
+    auto last_time = std::chrono::steady_clock::now();
+    auto last_instructions = m_telemetry.get_instructions();
+
+    while (!stop_token.stop_requested())
+    {
+        {
+            std::unique_lock lock(mutex);
+            wake_up.wait_for(lock, stop_token, COLLECT_INTERVAL, [] { return false; });
+        }
+        m_telemetry.collect();
+
+        const auto time = std::chrono::steady_clock::now();
+        if (time - last_time < m_interval)
+        {
+            continue;
+        }
+
+        const auto instructions = m_telemetry.get_instructions();
+        const auto seconds = std::chrono::duration<double>(time - last_time).count();
+
+        write_stats(seconds > 0 ? static_cast<double>(instructions - last_instructions) / seconds : 0);
+
+        last_time = time;
+        last_instructions = instructions;
+    }
+}
+
+auto Telemetry_Reporter::write_stats(const double instructions_per_second) const -> void
+{
+    auto temporary_path = m_stats_path;
+    temporary_path += ".tmp";
+
+    {
+        std::ofstream stats(temporary_path, std::ios::out | std::ios::trunc);
+        m_telemetry.write_exposition(stats, instructions_per_second);
+        if (!stats.good())
+        {
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, m_stats_path, error);
+}
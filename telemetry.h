@@ -0,0 +1,113 @@
+//
+// Runtime counters and histograms published as a text exposition file.
+//
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <thread>
+
+#include "spsc_queue.h"
+
+
+//Power of two buckets, only used by the thread collecting the frames
+class Histogram
+{
+public:
+    static constexpr std::size_t BUCKET_COUNT{24};
+
+    auto record(std::uint64_t value) -> void;
+    auto write_exposition(std::ostream& out, const char* name, const char* help) const -> void;
+
+private:
+    std::array<std::uint64_t, BUCKET_COUNT> m_buckets{};
+    std::uint64_t m_sum{};
+    std::uint64_t m_count{};
+};
+
+
+//Everything measured during one frame, filled in by the interpreter thread without any atomics
+struct Telemetry_Frame
+{
+    static constexpr std::size_t MAX_KEY_EVENTS{4};
+
+    std::uint64_t instructions{}; //Executed since start
+    std::uint32_t frame_time_us{};
+    std::uint32_t frame_jitter_us{};
+    std::uint32_t render_time_us{};
+    std::uint32_t render_bytes{};
+    std::uint32_t dropped_frames{};
+    bool late{false};
+    std::uint8_t key_event_count{}; //Latencies beyond MAX_KEY_EVENTS in one frame are not recorded
+    std::array<std::uint32_t, MAX_KEY_EVENTS> input_latency_us{};
+};
+
+
+/*
+ * The interpreter thread publishes one Telemetry_Frame per frame into a queue, the
+ * reporter thread collects them into the counters and histograms. A frame is a single
+ * push, the atomics of the queue are the only ones touched per frame. Frames that do
+ * not fit because the reporter fell behind are counted and reported.
+ */
+class Telemetry
+{
+public:
+    //Interpreter thread
+    auto publish(const Telemetry_Frame& frame) -> void;
+
+    //Reporter thread
+    auto collect() -> void;
+    [[nodiscard]] auto get_instructions() const -> std::uint64_t;
+    auto write_exposition(std::ostream& out, double instructions_per_second) const -> void;
+
+private:
+    struct Published_Frame
+    {
+        Telemetry_Frame frame{};
+        std::uint32_t lost_frames{}; //Frames before this one that did not fit into the queue
+    };
+
+    Spsc_Queue<Published_Frame, 1024> m_frames{};
+    std::uint32_t m_lost_frames{}; //Interpreter thread only
+
+    std::uint64_t m_instructions{};
+    std::uint64_t m_frame_count{};
+    std::uint64_t m_late_frames{};    //Started more than a tenth of the cycle time late
+    std::uint64_t m_dropped_frames{}; //Whole frame periods that were skipped
+    std::uint64_t m_bytes_written{};
+    std::uint64_t m_lost_frame_count{};
+
+    Histogram m_frame_time_us{};
+    Histogram m_frame_jitter_us{};
+    Histogram m_render_time_us{};
+    Histogram m_render_bytes{};
+    Histogram m_input_latency_us{};
+};
+
+
+//Rewrites the stats file periodically, the file is replaced atomically
+class Telemetry_Reporter
+{
+public:
+    Telemetry_Reporter(Telemetry& telemetry, std::filesystem::path stats_path,
+        std::chrono::milliseconds interval = std::chrono::seconds(1));
+
+private:
+    //Frames are collected more often than the file is written, so the queue does not fill up
+    static constexpr std::chrono::milliseconds COLLECT_INTERVAL{50};
+
+    auto reporter_thread(const std::stop_token& stop_token) -> void;
+    auto write_stats(double instructions_per_second) const -> void;
+
+    Telemetry& m_telemetry;
+    std::filesystem::path m_stats_path{};
+    std::chrono::milliseconds m_interval{};
+    std::jthread m_reporter{};
+};
+
+#endif //TELEMETRY_H
@@ -0,0 +1,311 @@
+//
+// Terminal frontend: raw keyboard input and text rendering around an interpreter.
+//
+
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "frame_exporter.h"
+#include "rom_library.h"
+#include "terminal_frontend.h"
+
+using namespace std::chrono_literals;
+
+
+Core_Machine::Core_Machine(const std::filesystem::path& rom_path, const std::uint64_t seed)
+{
+    const Mapped_File rom(rom_path);
+
+    core_reset(m_state, seed);
+    if (const auto status = core_load_rom(m_state, rom.get_bytes()); status != Core_Status::OK)
+    {
+        throw std::runtime_error(std::string(core_get_status_name(status)) + "!");
+    }
+}
+
+auto Core_Machine::run_frame(const int instructions_per_frame) -> bool
+{
+    if (const auto status = core_step_frame(m_state, instructions_per_frame); status != Core_Status::OK)
+    {
+        char message[96];
+        std::snprintf(message, sizeof(message), "%s at 0x%03X!", core_get_status_name(status),
+            m_state.program_counter - 2);
+        throw std::runtime_error(message);
+    }
+
+    return true;
+}
+
+auto Core_Machine::set_key_mask(const std::uint16_t key_mask) -> void
+{
+    m_state.key_mask = key_mask;
+}
+
+auto Core_Machine::get_packed_display(const std::span<std::uint8_t, CORE_PACKED_DISPLAY_BYTES> packed_display) const -> void
+{
+    core_get_packed_display(m_state, packed_display);
+}
+
+auto Core_Machine::get_instruction_count() const -> std::uint64_t
+{
+    return m_state.instruction_count;
+}
+
+
+Interpreter_Machine::Interpreter_Machine(Chip8& chip8)
+    : m_chip8(chip8)
+{
+}
+
+auto Interpreter_Machine::run_frame(const int instructions_per_frame) -> bool
+{
+    m_chip8.run_frame(instructions_per_frame);
+    m_chip8.update_timer();
+    return m_chip8.is_running();
+}
+
+auto Interpreter_Machine::set_key_mask(const std::uint16_t key_mask) -> void
+{
+    m_chip8.set_key_mask(key_mask);
+}
+
+auto Interpreter_Machine::get_packed_display(const std::span<std::uint8_t, CORE_PACKED_DISPLAY_BYTES> packed_display) const -> void
+{
+    m_chip8.get_packed_display(packed_display);
+}
+
+auto Interpreter_Machine::get_instruction_count() const -> std::uint64_t
+{
+    return m_chip8.get_instruction_count();
+}
+
+
+Terminal_Frontend::Terminal_Frontend()
+{
+    m_saved_flags = fcntl(STDIN_FILENO, F_GETFL);
+    fcntl(STDIN_FILENO, F_SETFL, m_saved_flags | O_NONBLOCK);
+
+    tcgetattr(STDIN_FILENO, &m_saved_terminal);
+    termios new_terminal = m_saved_terminal;
+    new_terminal.c_lflag &= ~(ICANON | ECHO);
+    tcsetattr(STDIN_FILENO, TCSANOW, &new_terminal);
+}
+
+Terminal_Frontend::~Terminal_Frontend()
+{
+    tcsetattr(STDIN_FILENO, TCSANOW, &m_saved_terminal);
+    fcntl(STDIN_FILENO, F_SETFL, m_saved_flags);
+}
+
+auto Terminal_Frontend::attach_telemetry(Telemetry* telemetry) -> void
+{
+    m_telemetry = telemetry;
+}
+
+auto Terminal_Frontend::attach_frame_exporter(Frame_Exporter* frame_exporter) -> void
+{
+    m_frame_exporter = frame_exporter;
+}
+
+auto Terminal_Frontend::set_input_paused(const bool paused) -> void
+{
+    m_input_paused = paused;
+}
+
+auto Terminal_Frontend::run(Terminal_Machine& machine, const int cycle_time, const int instructions_per_frame) -> void
+{
+    m_run = true;
+    std::jthread user_input([this] { user_input_thread(); });
+
+    //Key release is counted in frames on this thread, so input timing does not
+    //depend on when the input thread happens to run
+    const int key_hold_frames = std::max(1, TIME_TILL_KEY_RESETS_MS / std::max(cycle_time, 1));
+    std::array<std::uint8_t, CORE_PACKED_DISPLAY_BYTES> packed_display{};
+
+    auto begin_time = std::chrono::high_resolution_clock::now();
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto previous_begin_time = begin_time;
+
+    while (m_run)
+    {
+        const auto time_diff =
+            std::chrono::duration_cast<std::chrono::milliseconds>(end_time - begin_time).count();
+
+        if (time_diff > cycle_time)
+        {
+            previous_begin_time = begin_time;
+            begin_time = std::chrono::high_resolution_clock::now();
+
+            apply_key_events(key_hold_frames);
+            machine.set_key_mask(m_key_mask);
+            if (!machine.run_frame(instructions_per_frame))
+            {
+                m_run = false;
+                break;
+            }
+
+            machine.get_packed_display(packed_display);
+            if (m_frame_exporter != nullptr)
+            {
+                m_frame_exporter->submit(packed_display);
+            }
+
+            const auto render_begin_time = std::chrono::high_resolution_clock::now();
+            const auto bytes_written = draw_display(packed_display);
+
+            if (m_telemetry != nullptr)
+            {
+                record_frame_telemetry(machine, cycle_time, begin_time - previous_begin_time,
+                    std::chrono::high_resolution_clock::now() - render_begin_time, bytes_written);
+            }
+        }
+        end_time = std::chrono::high_resolution_clock::now();
+    }
+}
+
+auto Terminal_Frontend::user_input_thread() -> void
+{
+    int c{0};
+
+    while (m_run)
+    {
+        std::this_thread::sleep_for(5ms); //Reduce cpu utilization, maybe try some async methods soon
+        if (m_input_paused)
+        {
+            continue;
+        }
+
+        while ((c = std::getchar()) != EOF)
+        {
+            c = std::tolower(c);
+            if (c == ESC_KEY)
+            {
+                m_run = false;
+                return;
+            }
+
+            const auto key = CHAR_TO_KEYMAP.find(c);
+            if (key == CHAR_TO_KEYMAP.end())
+            {
+                continue;
+            }
+
+            //Released by the interpreter thread. Full queue drops the key
+            (void)m_key_events.try_push({
+                .key = static_cast<std::uint8_t>(key->second),
+                .timestamp = std::chrono::steady_clock::now(),
+            });
+        }
+    }
+}
+
+auto Terminal_Frontend::apply_key_events(const int key_hold_frames) -> void
+{
+    for (std::uint8_t key{0}; key < m_key_release_countdowns.size(); key++)
+    {
+        auto& countdown = m_key_release_countdowns[key];
+        if (countdown > 0 and --countdown == 0)
+        {
+            m_key_mask &= ~(1 << key);
+        }
+    }
+
+    Key_Event key_event{};
+    while (m_key_events.try_pop(key_event))
+    {
+        auto& key_event_count = m_telemetry_frame.key_event_count;
+        if (m_telemetry != nullptr and key_event_count < Telemetry_Frame::MAX_KEY_EVENTS)
+        {
+            const auto latency = std::chrono::steady_clock::now() - key_event.timestamp;
+            m_telemetry_frame.input_latency_us[key_event_count++] = static_cast<std::uint32_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+        }
+
+        const auto key = key_event.key & 0xF;
+        m_key_mask = 1 << key;
+        m_key_release_countdowns.fill(0);
+        m_key_release_countdowns[key] = key_hold_frames;
+    }
+}
+
+auto Terminal_Frontend::draw_display(const std::array<std::uint8_t, CORE_PACKED_DISPLAY_BYTES>& packed_display) -> std::size_t
+{
+    auto& buffer = m_draw_buffer;
+    buffer.clear();
+
+    //Clear terminal
+    buffer += "\033[H\033[J";
+    buffer += "\n\t";
+
+    for (int counter{1}; counter <= CORE_DISPLAY_WIDTH * CORE_DISPLAY_HEIGHT; counter++)
+    {
+        const int index = counter - 1;
+        if (packed_display[index / 8] >> (7 - index % 8) & 1)
+        {
+            //White Large Square Unicode
+            buffer += "\u2B1C";
+        }
+        else
+        {
+            //Black Large Square Unicode
+            buffer += "\u2B1B";
+        }
+
+        if (counter % CORE_DISPLAY_WIDTH == 0)
+        {
+            if (counter != CORE_DISPLAY_WIDTH * CORE_DISPLAY_HEIGHT)
+            {
+                buffer += "\n\t";
+            }
+        }
+    }
+
+    buffer += '\n';
+
+    constexpr auto keymap_str = R"(
+        KEYMAP
+        1 2 3 4      1 2 3 C
+        Q W E R  =>  4 5 6 D
+        A S D F      7 8 9 E
+        Z X C V      A 0 B F)";
+
+    buffer += keymap_str;
+    buffer += "\n\n\tPress ESC to exit.\n\n";
+
+    std::fwrite(buffer.data(), sizeof(char), buffer.size(), stdout);
+    return buffer.size();
+}
+
+auto Terminal_Frontend::record_frame_telemetry(const Terminal_Machine& machine, const int cycle_time,
+    const std::chrono::nanoseconds frame_time, const std::chrono::nanoseconds render_time,
+    const std::size_t bytes_written) -> void
+{
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+
+    //Filled in locally, the key events of the frame are already in it, and published in one go
+    auto& frame = m_telemetry_frame;
+    const auto frame_time_us = duration_cast<microseconds>(frame_time).count();
+    const std::int64_t cycle_time_us = std::max(cycle_time, 1) * 1000;
+
+    frame.instructions = machine.get_instruction_count();
+    frame.frame_time_us = static_cast<std::uint32_t>(frame_time_us);
+    frame.frame_jitter_us = static_cast<std::uint32_t>(std::abs(frame_time_us - cycle_time_us));
+    frame.render_time_us = static_cast<std::uint32_t>(duration_cast<microseconds>(render_time).count());
+    frame.render_bytes = static_cast<std::uint32_t>(bytes_written);
+
+    //The loop starts a frame once more than cycle_time has passed, anything beyond
+    //another tenth of it counts as late
+    frame.late = frame_time_us > cycle_time_us * 11 / 10 + 1000;
+    frame.dropped_frames = frame_time_us >= 2 * cycle_time_us
+        ? static_cast<std::uint32_t>(frame_time_us / cycle_time_us - 1)
+        : 0;
+
+    m_telemetry->publish(frame);
+    frame = {};
+}
@@ -0,0 +1,149 @@
+//
+// Terminal frontend: raw keyboard input and text rendering around an interpreter.
+//
+
+#ifndef TERMINAL_FRONTEND_H
+#define TERMINAL_FRONTEND_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <unordered_map>
+
+#include <termios.h>
+
+#include "chip8_core.h"
+#include "main.h"
+#include "spsc_queue.h"
+#include "telemetry.h"
+
+
+class Frame_Exporter;
+
+
+//What the frontend needs from an interpreter, one frame includes the timer tick
+class Terminal_Machine
+{
+public:
+    virtual ~Terminal_Machine() = default;
+
+    //Returns false once the machine stopped by itself
+    [[nodiscard]] virtual auto run_frame(int instructions_per_frame) -> bool = 0;
+    virtual auto set_key_mask(std::uint16_t key_mask) -> void = 0;
+    virtual auto get_packed_display(std::span<std::uint8_t, CORE_PACKED_DISPLAY_BYTES> packed_display) const -> void = 0;
+    [[nodiscard]] virtual auto get_instruction_count() const -> std::uint64_t = 0;
+};
+
+
+//Runs the allocation free core
+class Core_Machine: public Terminal_Machine
+{
+public:
+    Core_Machine(const std::filesystem::path& rom_path, std::uint64_t seed);
+
+    [[nodiscard]] auto run_frame(int instructions_per_frame) -> bool override;
+    auto set_key_mask(std::uint16_t key_mask) -> void override;
+    auto get_packed_display(std::span<std::uint8_t, CORE_PACKED_DISPLAY_BYTES> packed_display) const -> void override;
+    [[nodiscard]] auto get_instruction_count() const -> std::uint64_t override;
+
+private:
+    Core_State m_state{};
+};
+
+
+//Runs a Chip8, for the debugger, tracer and timing models the core does not have
+class Interpreter_Machine: public Terminal_Machine
+{
+public:
+    explicit Interpreter_Machine(Chip8& chip8);
+
+    [[nodiscard]] auto run_frame(int instructions_per_frame) -> bool override;
+    auto set_key_mask(std::uint16_t key_mask) -> void override;
+    auto get_packed_display(std::span<std::uint8_t, CORE_PACKED_DISPLAY_BYTES> packed_display) const -> void override;
+    [[nodiscard]] auto get_instruction_count() const -> std::uint64_t override;
+
+private:
+    Chip8& m_chip8;
+};
+
+
+class Terminal_Frontend
+{
+public:
+    enum class Keymap
+    {
+        /*
+        * Keymap
+        * 1 2 3 4      1 2 3 C
+        * Q W E R  =>  4 5 6 D
+        * A S D F      7 8 9 E
+        * Z X C V      A 0 B F
+        */
+
+        K_1 = 0x1, K_2 = 0x2, K_3 = 0x3, K_4 = 0xC,
+        K_Q = 0x4, K_W = 0x5, K_E = 0x6, K_R = 0xD,
+        K_A = 0x7, K_S = 0x8, K_D = 0x9, K_F = 0xE,
+        K_Z = 0xA, K_X = 0x0, K_C = 0xB, K_V = 0xF,
+    };
+
+    static inline const std::unordered_map<int, Keymap> CHAR_TO_KEYMAP
+    {
+        {49, Keymap::K_1}, {50, Keymap::K_2}, {51, Keymap::K_3}, {52, Keymap::K_4},
+        {113, Keymap::K_Q}, {119, Keymap::K_W}, {101, Keymap::K_E}, {114, Keymap::K_R},
+        {97, Keymap::K_A}, {115, Keymap::K_S}, {100, Keymap::K_D}, {102, Keymap::K_F},
+        {122, Keymap::K_Z}, {120, Keymap::K_X}, {99, Keymap::K_C}, {118, Keymap::K_V},
+    };
+
+    //A terminal only reports presses, so every key event is a tap: it releases every other
+    //key and is released after TIME_TILL_KEY_RESETS_MS
+    struct Key_Event
+    {
+        std::uint8_t key;
+        std::chrono::steady_clock::time_point timestamp;
+    };
+
+    static constexpr int ESC_KEY{27};
+    static constexpr int TIME_TILL_KEY_RESETS_MS{150};
+
+    //Switches the terminal to unbuffered, non blocking input until destroyed
+    Terminal_Frontend();
+    ~Terminal_Frontend();
+
+    Terminal_Frontend(const Terminal_Frontend&) = delete;
+    auto operator=(const Terminal_Frontend&) -> Terminal_Frontend& = delete;
+
+    auto attach_telemetry(Telemetry* telemetry) -> void;
+    auto attach_frame_exporter(Frame_Exporter* frame_exporter) -> void;
+    //Stops reading keys, e.g. while the debugger prompt reads from the terminal
+    auto set_input_paused(bool paused) -> void;
+
+    //Runs until ESC is pressed or the machine stops
+    auto run(Terminal_Machine& machine, int cycle_time, int instructions_per_frame) -> void;
+
+private:
+    auto user_input_thread() -> void;
+    auto apply_key_events(int key_hold_frames) -> void;
+    auto draw_display(const std::array<std::uint8_t, CORE_PACKED_DISPLAY_BYTES>& packed_display) -> std::size_t; //Returns the bytes written
+    auto record_frame_telemetry(const Terminal_Machine& machine, int cycle_time, std::chrono::nanoseconds frame_time,
+        std::chrono::nanoseconds render_time, std::size_t bytes_written) -> void;
+
+    termios m_saved_terminal{};
+    int m_saved_flags{};
+
+    std::atomic_bool m_run{true};
+    std::atomic_bool m_input_paused{false};
+    Spsc_Queue<Key_Event, 64> m_key_events{}; //Filled by the input thread only, applied at the next frame boundary
+    std::uint16_t m_key_mask{};
+    std::array<int, 16> m_key_release_countdowns{};
+
+    std::string m_draw_buffer{};
+    Telemetry* m_telemetry{nullptr};
+    Telemetry_Frame m_telemetry_frame{}; //Frame being measured
+    Frame_Exporter* m_frame_exporter{nullptr};
+};
+
+#endif //TERMINAL_FRONTEND_H
@@ -0,0 +1,174 @@
+//
+// Decoder for binary execution traces.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "debugger.h"
+#include "tracer.h"
+
+
+auto read_trace(const std::filesystem::path& trace_path) -> std::vector<Trace_Record>
+{
+    std::ifstream trace(trace_path, std::ios::binary | std::ios::in);
+    if (!trace.good())
+    {
+        throw std::runtime_error("Failed to open " + trace_path.string() + "!");
+    }
+
+    Trace_Header header{};
+    trace.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!trace.good() or header.magic != Trace_Header{}.magic or header.record_size != sizeof(Trace_Record))
+    {
+        throw std::runtime_error(trace_path.string() + " is not a trace file!");
+    }
+
+    const auto size = std::filesystem::file_size(trace_path) - sizeof(header);
+    std::vector<Trace_Record> records(size / sizeof(Trace_Record));
+    trace.read(reinterpret_cast<char*>(records.data()),
+        static_cast<std::streamsize>(records.size() * sizeof(Trace_Record)));
+
+    return records;
+}
+
+auto format_record(const Trace_Record& trace_record) -> std::string
+{
+    const auto& [program_counter, opcode, index_register,
+        changed_register, changed_value, vf, flags] = trace_record;
+
+    const char* name = Debugger::get_instruction_name(Chip8::decode(Chip8::get_nibbles(opcode)));
+
+    char line[64];
+    if (changed_register != Trace_Record::NO_REGISTER)
+    {
+        std::snprintf(line, sizeof(line), "%03X  %04X  %s  I=%03X  VF=%02X  V%X=%02X",
+            program_counter, opcode, name, index_register, vf, changed_register, changed_value);
+    }
+    else
+    {
+        std::snprintf(line, sizeof(line), "%03X  %04X  %s  I=%03X  VF=%02X",
+            program_counter, opcode, name, index_register, vf);
+    }
+
+    if (flags & Trace_Record::FAULTED)
+    {
+        return std::string(line) + "  FAULT";
+    }
+    return line;
+}
+
+auto is_same_record(const Trace_Record& a, const Trace_Record& b) -> bool
+{
+    return a.program_counter == b.program_counter and a.opcode == b.opcode
+        and a.index_register == b.index_register and a.changed_register == b.changed_register
+        and a.changed_value == b.changed_value and a.vf == b.vf and a.flags == b.flags;
+}
+
+auto print_text(const std::vector<Trace_Record>& records) -> void
+{
+    for (std::size_t i{0}; i < records.size(); i++)
+    {
+        std::printf("%10zu  %s\n", i, format_record(records[i]).c_str());
+    }
+}
+
+auto print_diff(const std::vector<Trace_Record>& a, const std::vector<Trace_Record>& b, const std::size_t max_lines) -> int
+{
+    std::size_t differences{0};
+    const auto common = std::min(a.size(), b.size());
+    for (std::size_t i{0}; i < common; i++)
+    {
+        if (is_same_record(a[i], b[i]))
+        {
+            continue;
+        }
+
+        if (differences++ < max_lines)
+        {
+            std::printf("%10zu  %-40s | %s\n", i, format_record(a[i]).c_str(), format_record(b[i]).c_str());
+        }
+    }
+
+    std::printf("%zu of %zu records differ", differences, common);
+    if (a.size() != b.size())
+    {
+        std::printf(", lengths %zu and %zu", a.size(), b.size());
+    }
+    std::printf("\n");
+
+    return differences == 0 and a.size() == b.size() ? 0 : 1;
+}
+
+auto print_divergence(const std::vector<Trace_Record>& a, const std::vector<Trace_Record>& b) -> int
+{
+    constexpr std::size_t CONTEXT{8};
+
+    const auto common = std::min(a.size(), b.size());
+    std::size_t first{0};
+    while (first < common and is_same_record(a[first], b[first]))
+    {
+        first++;
+    }
+
+    if (first == common)
+    {
+        if (a.size() == b.size())
+        {
+            std::printf("Traces are identical (%zu records)\n", a.size());
+            return 0;
+        }
+
+        std::printf("Traces agree for %zu records, then one ends\n", common);
+        return 1;
+    }
+
+    std::printf("First divergence at record %zu\n", first);
+    for (auto i = first - std::min(first, CONTEXT); i < first; i++)
+    {
+        std::printf("  %10zu  %s\n", i, format_record(a[i]).c_str());
+    }
+    std::printf("< %10zu  %s\n", first, format_record(a[first]).c_str());
+    std::printf("> %10zu  %s\n", first, format_record(b[first]).c_str());
+
+    return 1;
+}
+
+
+auto main(int argc, char** argv) -> int
+{
+    try
+    {
+        const std::vector<std::string> args(argv + 1, argv + argc);
+
+        if (args.size() == 2 and args[0] == "text")
+        {
+            print_text(read_trace(args[1]));
+            return 0;
+        }
+
+        if ((args.size() == 3 or args.size() == 4) and args[0] == "diff")
+        {
+            const std::size_t max_lines = args.size() == 4 ? std::stoul(args[3]) : 50;
+            return print_diff(read_trace(args[1]), read_trace(args[2]), max_lines);
+        }
+
+        if (args.size() == 3 and args[0] == "divergence")
+        {
+            return print_divergence(read_trace(args[1]), read_trace(args[2]));
+        }
+
+        throw std::runtime_error("Usage: ./Chip8TraceTool text trace\n"
+                                 "       ./Chip8TraceTool diff trace_a trace_b [max lines]\n"
+                                 "       ./Chip8TraceTool divergence trace_a trace_b\n");
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "%s", e.what());
+    }
+
+    return 2;
+}
@@ -0,0 +1,97 @@
+//
+// Binary execution trace written by a background thread.
+//
+
+#include "tracer.h"
+
+
+Tracer::Tracer(const std::filesystem::path& trace_path)
+    : m_file(trace_path, std::ios::binary | std::ios::out | std::ios::trunc)
+{
+    if (!m_file.good())
+    {
+        throw std::runtime_error("Failed to open trace file!");
+    }
+
+    constexpr Trace_Header header{};
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    m_current.reserve(BLOCK_RECORDS);
+    for (std::size_t i{1}; i < BLOCK_COUNT; i++)
+    {
+        m_free_blocks.emplace_back().reserve(BLOCK_RECORDS);
+    }
+
+    m_writer = std::jthread(&Tracer::writer_thread, this);
+}
+
+Tracer::~Tracer()
+{
+    submit_block();
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+    m_block_available.notify_all();
+    m_writer.join();
+}
+
+auto Tracer::flush() -> void
+{
+    submit_block();
+
+    std::unique_lock lock(m_mutex);
+    m_block_available.wait(lock, [this]
+    {
+        return m_full_blocks.empty() and m_free_blocks.size() == BLOCK_COUNT - 1;
+    });
+    m_file.flush();
+}
+
+auto Tracer::submit_block() -> void
+{
+    if (m_current.empty())
+    {
+        return;
+    }
+
+    std::unique_lock lock(m_mutex);
+    m_full_blocks.push_back(std::move(m_current));
+    m_block_available.notify_all();
+
+    m_block_available.wait(lock, [this]
+    {
+        return !m_free_blocks.empty();
+    });
+    m_current = std::move(m_free_blocks.back());
+    m_free_blocks.pop_back();
+}
+
+auto Tracer::writer_thread() -> void
+{
+    std::unique_lock lock(m_mutex);
+    while (true)
+    {
+        m_block_available.wait(lock, [this]
+        {
+            return m_stop or !m_full_blocks.empty();
+        });
+
+        if (m_full_blocks.empty())
+        {
+            return;
+        }
+
+        auto block = std::move(m_full_blocks.front());
+        m_full_blocks.pop_front();
+
+        lock.unlock();
+        m_file.write(reinterpret_cast<const char*>(block.data()),
+            static_cast<std::streamsize>(block.size() * sizeof(Trace_Record)));
+        block.clear();
+        lock.lock();
+
+        m_free_blocks.push_back(std::move(block));
+        m_block_available.notify_all();
+    }
+}
@@ -0,0 +1,96 @@
+//
+// Binary execution trace written by a background thread.
+//
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+struct Trace_Record
+{
+    std::uint16_t program_counter;
+    std::uint16_t opcode;
+    std::uint16_t index_register; //After the instruction
+    std::uint8_t changed_register; //First of V0-VE written with a new value, NO_REGISTER if none
+    std::uint8_t changed_value;
+    std::uint8_t vf;
+    std::uint8_t flags;
+
+    static constexpr std::uint8_t NO_REGISTER{0xFF};
+    static constexpr std::uint8_t FAULTED{0x01}; //The instruction threw, the state is where it stopped
+};
+
+static_assert(sizeof(Trace_Record) == 10);
+
+
+struct Trace_Header
+{
+    std::array<char, 4> magic{'C', '8', 'T', 'R'};
+    std::uint8_t version{1};
+    std::uint8_t record_size{sizeof(Trace_Record)};
+    std::uint16_t reserved{};
+};
+
+static_assert(sizeof(Trace_Header) == 8);
+
+
+/*
+ * Records are collected in large blocks. A full block is handed to a writer thread
+ * and recording continues in the next free one, so the interpreter only takes a lock
+ * once per block. If the writer falls behind the interpreter waits instead of losing
+ * records.
+ */
+class Tracer
+{
+public:
+    static constexpr std::size_t BLOCK_RECORDS{1 << 16};
+    static constexpr std::size_t BLOCK_COUNT{4};
+
+    explicit Tracer(const std::filesystem::path& trace_path);
+    ~Tracer();
+
+    Tracer(const Tracer&) = delete;
+    auto operator=(const Tracer&) -> Tracer& = delete;
+
+    auto record(const Trace_Record& trace_record) -> void;
+    auto flush() -> void;
+
+private:
+    using Block = std::vector<Trace_Record>;
+
+    auto submit_block() -> void;
+    auto writer_thread() -> void;
+
+    std::ofstream m_file{};
+
+    Block m_current{};
+    std::vector<Block> m_free_blocks{};
+    std::deque<Block> m_full_blocks{};
+
+    std::mutex m_mutex{};
+    std::condition_variable m_block_available{};
+    bool m_stop{false};
+    std::jthread m_writer{};
+};
+
+
+inline auto Tracer::record(const Trace_Record& trace_record) -> void
+{
+    m_current.push_back(trace_record);
+    if (m_current.size() == BLOCK_RECORDS)
+    {
+        submit_block();
+    }
+}
+
+#endif //TRACER_H
@@ -0,0 +1,111 @@
+//
+// Keys for incrementally maintained Zobrist-style state hashes.
+//
+
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+#include <span>
+
+#include "pcg32.h"
+
+
+//SplitMix64 finalizer, used instead of a random table so no key table has to be stored
+[[nodiscard]] constexpr auto zobrist_mix(std::uint64_t value) -> std::uint64_t
+{
+    value += 0x9E3779B97F4A7C15;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EB;
+    return value ^ (value >> 31);
+}
+
+//Zero bytes have no key, so cleared memory hashes to 0
+[[nodiscard]] constexpr auto zobrist_memory_key(const std::uint64_t address, const std::uint8_t value) -> std::uint64_t
+{
+    return value == 0 ? 0 : zobrist_mix(address << 8 | value);
+}
+
+//Lit pixels only, so a cleared display hashes to 0
+[[nodiscard]] constexpr auto zobrist_pixel_key(const std::uint64_t index) -> std::uint64_t
+{
+    return zobrist_mix(std::uint64_t{1} << 32 | index);
+}
+
+//Return address at a call depth
+[[nodiscard]] constexpr auto zobrist_stack_key(const std::uint64_t depth, const std::uint16_t address) -> std::uint64_t
+{
+    return zobrist_mix(std::uint64_t{2} << 32 | depth << 16 | address);
+}
+
+//Registers, timers, keys and the random generator are a few dozen bytes. Nearly every instruction
+//writes one of them, so they are mixed in when the hash is read instead of keyed on every write.
+//Cpu is Chip8::Cpu_State or Core_State, which name these fields the same
+template<typename Cpu>
+[[nodiscard]] constexpr auto zobrist_fold_cpu(std::uint64_t hash, const Cpu& cpu, const Pcg32& random) -> std::uint64_t
+{
+    const auto add_value = [&hash](const std::uint64_t value)
+    {
+        hash = zobrist_mix(hash ^ value);
+    };
+
+    for (std::size_t reg{0}; reg < cpu.registers.size(); reg += 8)
+    {
+        std::uint64_t packed{0};
+        for (std::size_t byte{0}; byte < 8; byte++)
+        {
+            packed |= std::uint64_t{cpu.registers[reg + byte]} << byte * 8;
+        }
+        add_value(packed);
+    }
+
+    add_value(std::uint64_t{cpu.index_register} | std::uint64_t{cpu.program_counter} << 16
+        | std::uint64_t{cpu.delay_timer} << 32 | std::uint64_t{cpu.sound_timer} << 40);
+    add_value(std::uint64_t{cpu.stack_pointer} | std::uint64_t{cpu.key_mask} << 8);
+    add_value(random.state);
+    add_value(random.increment);
+
+    return hash;
+}
+
+//The hashes below are computed from scratch, to check the incrementally updated ones
+
+[[nodiscard]] constexpr auto zobrist_memory_hash(const std::span<const std::uint8_t> memory) -> std::uint64_t
+{
+    std::uint64_t hash{0};
+    for (std::size_t address{0}; address < memory.size(); address++)
+    {
+        hash ^= zobrist_memory_key(address, memory[address]);
+    }
+    return hash;
+}
+
+//One word per row of 64 pixels, the most significant bit is the leftmost pixel
+[[nodiscard]] constexpr auto zobrist_display_hash(const std::span<const std::uint64_t> rows) -> std::uint64_t
+{
+    std::uint64_t hash{0};
+    for (std::size_t row{0}; row < rows.size(); row++)
+    {
+        for (std::size_t column{0}; column < 64; column++)
+        {
+            if (rows[row] >> (63 - column) & 1)
+            {
+                hash ^= zobrist_pixel_key(row * 64 + column);
+            }
+        }
+    }
+    return hash;
+}
+
+//Return addresses from the bottom of the stack up
+[[nodiscard]] constexpr auto zobrist_stack_hash(const std::span<const std::uint16_t> stack) -> std::uint64_t
+{
+    std::uint64_t hash{0};
+    for (std::size_t depth{0}; depth < stack.size(); depth++)
+    {
+        hash ^= zobrist_stack_key(depth, stack[depth]);
+    }
+    return hash;
+}
+
+#endif //ZOBRIST_H